@@ -0,0 +1,348 @@
+#ifndef BATCH_SIMULATOR_H
+#define BATCH_SIMULATOR_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "grid.h"
+#include "map.h"
+#include "rng.h"
+#include "robot.h"
+#include "stats.h"
+
+// simulates a batch of robots at the same time, one robot per vector lane
+// every lane takes one step per loop, lanes that run out of power are masked off
+// until the whole batch is finished
+//
+// each lane does exactly what Robot::updateSensor() and Robot::update() do, with the
+// lane's own random stream, so a robot ends up in the same state either way
+template <typename Grid>
+class BatchSimulator
+{
+    public:
+#if defined(__AVX512F__)
+        static constexpr std::size_t LANES {16};
+#else
+        static constexpr std::size_t LANES {8};
+#endif
+    private:
+        static constexpr std::size_t TABLE_STRIDE {84};
+
+        Grid m_grid {};
+        // every lane's copy of the grid as sensor codes, each padded so a 4 byte gather
+        // at the last spot stays inside the lane
+        std::vector<std::uint8_t> m_cells {};
+        alignas(64) std::array<std::uint8_t, LANES * TABLE_STRIDE> m_tables {};
+        alignas(64) std::array<std::int32_t, LANES> m_position {};
+        alignas(64) std::array<std::int32_t, LANES> m_power {};
+        alignas(64) std::array<std::int32_t, LANES> m_turnsSurvived {};
+        alignas(64) std::array<std::int32_t, LANES> m_powerHarvested {};
+        std::array<Rng, LANES> m_rngs {};
+
+        std::size_t cellStride() const {return m_grid.cellCount() + 4;}
+
+        // one step for one lane, the same rules as Map::moveNorth and friends
+        void stepLane(std::size_t lane)
+        {
+            const int row {m_grid.rowLength()};
+            // how far the position moves for north, south, east and west
+            const std::array<std::int32_t, 4> moveOffsets {-row, row, 1, -1};
+
+            std::uint8_t* cells {&m_cells[lane * cellStride()]};
+            std::int32_t position {m_position[lane]};
+
+            std::size_t sensor {sensorIndex(cells[position - row], cells[position + row], cells[position + 1], cells[position - 1])};
+            int action {m_tables[lane * TABLE_STRIDE + sensor]};
+            if (action == RandomDir)
+            {
+                GA_COUNT(randomActions, 1);
+                action = m_rngs[lane].nextInt(4);
+            }
+
+            std::int32_t target {position + moveOffsets[static_cast<std::size_t>(action)]};
+            std::uint8_t tile {cells[target]};
+
+            --m_power[lane];
+            ++m_turnsSurvived[lane];
+            GA_COUNT(steps, 1);
+
+            if (tile == WALL)
+            {
+                GA_COUNT(wallBumps, 1);
+                return;
+            }
+
+            if (tile == BATTERY)
+            {
+                GA_COUNT(batteryPickups, 1);
+                m_power[lane] += 5;
+                m_powerHarvested[lane] += 5;
+                cells[target] = EMPTY;
+            }
+            m_position[lane] = target;
+        }
+
+        void runScalar()
+        {
+            // lanes are independent, so the fallback can just finish them one at a time
+            for (std::size_t lane {0}; lane < LANES; ++lane)
+            {
+                while (m_power[lane] != 0)
+                {
+                    stepLane(lane);
+                }
+            }
+        }
+
+#if defined(__AVX512F__)
+        // the masked forms with a zero source are used for gathers and permutes since the
+        // plain ones trip a false uninitialized warning inside the compiler's own header
+        static __m512i gather512(__m512i offsets, const std::uint8_t* base)
+        {
+            return _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), static_cast<__mmask16>(0xFFFF), offsets, base, 1);
+        }
+
+        void runVector()
+        {
+            const __m512i laneIds {_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)};
+            const int row {m_grid.rowLength()};
+            const __m512i cellBase {_mm512_mullo_epi32(laneIds, _mm512_set1_epi32(static_cast<int>(cellStride())))};
+            const __m512i tableBase {_mm512_mullo_epi32(laneIds, _mm512_set1_epi32(static_cast<int>(TABLE_STRIDE)))};
+            const __m512i moveOffsets {_mm512_setr_epi32(-row, row, 1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0)};
+            const __m512i byteMask {_mm512_set1_epi32(0xFF)};
+            const __m512i three {_mm512_set1_epi32(3)};
+            const __m512i random {_mm512_set1_epi32(RandomDir)};
+            const __m512i wall {_mm512_set1_epi32(WALL)};
+            const __m512i battery {_mm512_set1_epi32(BATTERY)};
+            const __m512i one {_mm512_set1_epi32(1)};
+            const __m512i batteryPower {_mm512_set1_epi32(5)};
+
+            __m512i position {_mm512_load_si512(m_position.data())};
+            __m512i power {_mm512_load_si512(m_power.data())};
+            __m512i turnsSurvived {_mm512_load_si512(m_turnsSurvived.data())};
+            __m512i powerHarvested {_mm512_load_si512(m_powerHarvested.data())};
+            __mmask16 alive {_mm512_cmpgt_epi32_mask(power, _mm512_setzero_si512())};
+
+            alignas(64) std::array<std::int32_t, LANES> spill {};
+
+            while (alive)
+            {
+                __m512i cell {_mm512_add_epi32(cellBase, position)};
+                __m512i north {_mm512_and_si512(gather512(_mm512_sub_epi32(cell, _mm512_set1_epi32(row)), m_cells.data()), byteMask)};
+                __m512i south {_mm512_and_si512(gather512(_mm512_add_epi32(cell, _mm512_set1_epi32(row)), m_cells.data()), byteMask)};
+                __m512i east {_mm512_and_si512(gather512(_mm512_add_epi32(cell, one), m_cells.data()), byteMask)};
+                __m512i west {_mm512_and_si512(gather512(_mm512_sub_epi32(cell, one), m_cells.data()), byteMask)};
+
+                __m512i sensor {_mm512_add_epi32(_mm512_mullo_epi32(north, three), south)};
+                sensor = _mm512_add_epi32(_mm512_mullo_epi32(sensor, three), east);
+                sensor = _mm512_add_epi32(_mm512_mullo_epi32(sensor, three), west);
+
+                __m512i action {_mm512_and_si512(gather512(_mm512_add_epi32(tableBase, sensor), m_tables.data()), byteMask)};
+
+                // random directions come from each lane's own stream
+                __mmask16 randomLanes {static_cast<__mmask16>(_mm512_cmpeq_epi32_mask(action, random) & alive)};
+                GA_COUNT(randomActions, __builtin_popcount(randomLanes));
+                if (randomLanes)
+                {
+                    _mm512_store_si512(spill.data(), action);
+                    for (std::size_t lane {0}; lane < LANES; ++lane)
+                    {
+                        if (randomLanes & (1u << lane))
+                            spill[lane] = m_rngs[lane].nextInt(4);
+                    }
+                    action = _mm512_load_si512(spill.data());
+                }
+
+                __m512i target {_mm512_add_epi32(position, _mm512_maskz_permutexvar_epi32(static_cast<__mmask16>(0xFFFF), action, moveOffsets))};
+                __m512i tile {_mm512_and_si512(gather512(_mm512_add_epi32(cellBase, target), m_cells.data()), byteMask)};
+
+                __mmask16 moves {static_cast<__mmask16>(_mm512_cmpneq_epi32_mask(tile, wall) & alive)};
+                __mmask16 batteries {static_cast<__mmask16>(_mm512_cmpeq_epi32_mask(tile, battery) & alive)};
+                GA_COUNT(steps, __builtin_popcount(alive));
+                GA_COUNT(wallBumps, __builtin_popcount(alive & ~moves));
+                GA_COUNT(batteryPickups, __builtin_popcount(batteries));
+
+                power = _mm512_mask_sub_epi32(power, alive, power, one);
+                turnsSurvived = _mm512_mask_add_epi32(turnsSurvived, alive, turnsSurvived, one);
+                power = _mm512_mask_add_epi32(power, batteries, power, batteryPower);
+                powerHarvested = _mm512_mask_add_epi32(powerHarvested, batteries, powerHarvested, batteryPower);
+                position = _mm512_mask_blend_epi32(moves, position, target);
+
+                // eaten batteries are cleared one lane at a time since there is no byte scatter
+                if (batteries)
+                {
+                    _mm512_store_si512(spill.data(), target);
+                    for (std::size_t lane {0}; lane < LANES; ++lane)
+                    {
+                        if (batteries & (1u << lane))
+                            m_cells[lane * cellStride() + static_cast<std::size_t>(spill[lane])] = EMPTY;
+                    }
+                }
+
+                alive = static_cast<__mmask16>(_mm512_cmpgt_epi32_mask(power, _mm512_setzero_si512()) & alive);
+            }
+
+            _mm512_store_si512(m_position.data(), position);
+            _mm512_store_si512(m_power.data(), power);
+            _mm512_store_si512(m_turnsSurvived.data(), turnsSurvived);
+            _mm512_store_si512(m_powerHarvested.data(), powerHarvested);
+        }
+#elif defined(__AVX2__)
+        void runVector()
+        {
+            const __m256i laneIds {_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)};
+            const int row {m_grid.rowLength()};
+            const __m256i cellBase {_mm256_mullo_epi32(laneIds, _mm256_set1_epi32(static_cast<int>(cellStride())))};
+            const __m256i tableBase {_mm256_mullo_epi32(laneIds, _mm256_set1_epi32(static_cast<int>(TABLE_STRIDE)))};
+            const __m256i moveOffsets {_mm256_setr_epi32(-row, row, 1, -1, 0, 0, 0, 0)};
+            const __m256i byteMask {_mm256_set1_epi32(0xFF)};
+            const __m256i three {_mm256_set1_epi32(3)};
+            const __m256i random {_mm256_set1_epi32(RandomDir)};
+            const __m256i wall {_mm256_set1_epi32(WALL)};
+            const __m256i battery {_mm256_set1_epi32(BATTERY)};
+            const __m256i one {_mm256_set1_epi32(1)};
+            const __m256i batteryPower {_mm256_set1_epi32(5)};
+            const int* cells {reinterpret_cast<const int*>(m_cells.data())};
+            const int* tables {reinterpret_cast<const int*>(m_tables.data())};
+
+            __m256i position {_mm256_load_si256(reinterpret_cast<const __m256i*>(m_position.data()))};
+            __m256i power {_mm256_load_si256(reinterpret_cast<const __m256i*>(m_power.data()))};
+            __m256i turnsSurvived {_mm256_load_si256(reinterpret_cast<const __m256i*>(m_turnsSurvived.data()))};
+            __m256i powerHarvested {_mm256_load_si256(reinterpret_cast<const __m256i*>(m_powerHarvested.data()))};
+            // every bit set in a lane means the lane is alive
+            __m256i alive {_mm256_cmpgt_epi32(power, _mm256_setzero_si256())};
+
+            alignas(32) std::array<std::int32_t, LANES> spill {};
+
+            while (_mm256_movemask_epi8(alive))
+            {
+                __m256i cell {_mm256_add_epi32(cellBase, position)};
+                __m256i north {_mm256_and_si256(_mm256_i32gather_epi32(cells, _mm256_sub_epi32(cell, _mm256_set1_epi32(row)), 1), byteMask)};
+                __m256i south {_mm256_and_si256(_mm256_i32gather_epi32(cells, _mm256_add_epi32(cell, _mm256_set1_epi32(row)), 1), byteMask)};
+                __m256i east {_mm256_and_si256(_mm256_i32gather_epi32(cells, _mm256_add_epi32(cell, one), 1), byteMask)};
+                __m256i west {_mm256_and_si256(_mm256_i32gather_epi32(cells, _mm256_sub_epi32(cell, one), 1), byteMask)};
+
+                __m256i sensor {_mm256_add_epi32(_mm256_mullo_epi32(north, three), south)};
+                sensor = _mm256_add_epi32(_mm256_mullo_epi32(sensor, three), east);
+                sensor = _mm256_add_epi32(_mm256_mullo_epi32(sensor, three), west);
+
+                __m256i action {_mm256_and_si256(_mm256_i32gather_epi32(tables, _mm256_add_epi32(tableBase, sensor), 1), byteMask)};
+
+                // random directions come from each lane's own stream
+                int randomLanes {_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(_mm256_cmpeq_epi32(action, random), alive)))};
+                GA_COUNT(randomActions, __builtin_popcount(static_cast<unsigned>(randomLanes)));
+                if (randomLanes)
+                {
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(spill.data()), action);
+                    for (std::size_t lane {0}; lane < LANES; ++lane)
+                    {
+                        if (randomLanes & (1 << lane))
+                            spill[lane] = m_rngs[lane].nextInt(4);
+                    }
+                    action = _mm256_load_si256(reinterpret_cast<const __m256i*>(spill.data()));
+                }
+
+                __m256i target {_mm256_add_epi32(position, _mm256_permutevar8x32_epi32(moveOffsets, action))};
+                __m256i tile {_mm256_and_si256(_mm256_i32gather_epi32(cells, _mm256_add_epi32(cellBase, target), 1), byteMask)};
+
+                __m256i moves {_mm256_andnot_si256(_mm256_cmpeq_epi32(tile, wall), alive)};
+                __m256i batteries {_mm256_and_si256(_mm256_cmpeq_epi32(tile, battery), alive)};
+
+                // alive lanes are -1, so adding the mask takes one power and subtracting it adds one turn
+                power = _mm256_add_epi32(power, alive);
+                turnsSurvived = _mm256_sub_epi32(turnsSurvived, alive);
+                power = _mm256_add_epi32(power, _mm256_and_si256(batteries, batteryPower));
+                powerHarvested = _mm256_add_epi32(powerHarvested, _mm256_and_si256(batteries, batteryPower));
+                position = _mm256_blendv_epi8(position, target, moves);
+
+                // eaten batteries are cleared one lane at a time since there is no scatter
+                int batteryLanes {_mm256_movemask_ps(_mm256_castsi256_ps(batteries))};
+                GA_COUNT(steps, __builtin_popcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(alive)))));
+                GA_COUNT(wallBumps, __builtin_popcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_andnot_si256(moves, alive))))));
+                GA_COUNT(batteryPickups, __builtin_popcount(static_cast<unsigned>(batteryLanes)));
+                if (batteryLanes)
+                {
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(spill.data()), target);
+                    for (std::size_t lane {0}; lane < LANES; ++lane)
+                    {
+                        if (batteryLanes & (1 << lane))
+                            m_cells[lane * cellStride() + static_cast<std::size_t>(spill[lane])] = EMPTY;
+                    }
+                }
+
+                alive = _mm256_and_si256(alive, _mm256_cmpgt_epi32(power, _mm256_setzero_si256()));
+            }
+
+            _mm256_store_si256(reinterpret_cast<__m256i*>(m_position.data()), position);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(m_power.data()), power);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(m_turnsSurvived.data()), turnsSurvived);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(m_powerHarvested.data()), powerHarvested);
+        }
+#endif
+    public:
+        explicit BatchSimulator(const Grid& grid = Grid {})
+        : m_grid {grid}
+        , m_cells(LANES * cellStride())
+        {
+            clear();
+        }
+
+        // true when this build has a vector kernel, otherwise run() uses the scalar fallback
+        static constexpr bool isVectorized()
+        {
+#if defined(__AVX512F__) || defined(__AVX2__)
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        // empty every lane, a lane with no power is never stepped
+        void clear()
+        {
+            m_power.fill(0);
+            m_position.fill(m_grid.rowLength() + 1);
+            m_turnsSurvived.fill(0);
+            m_powerHarvested.fill(0);
+        }
+
+        // put a freshly spawned robot into a lane
+        // the action table comes from Genome::compileActionTable()
+        void loadLane(std::size_t lane, const std::array<std::uint8_t, SENSOR_STATES>& actionTable, const BatteryLayout<Grid>& layout, Coordinates coordinates, const Rng& rng)
+        {
+            std::memcpy(&m_cells[lane * cellStride()], layout.getSensorCodes().data(), m_grid.cellCount());
+
+            std::memcpy(&m_tables[lane * TABLE_STRIDE], actionTable.data(), actionTable.size());
+
+            m_position[lane] = coordinates.x * m_grid.rowLength() + coordinates.y;
+            m_power[lane] = STARTING_POWER;
+            m_turnsSurvived[lane] = 0;
+            m_powerHarvested[lane] = 0;
+            m_rngs[lane] = rng;
+        }
+
+        // step every lane until all of them are out of power
+        void run()
+        {
+#if defined(__AVX512F__) || defined(__AVX2__)
+            runVector();
+#else
+            runScalar();
+#endif
+        }
+
+        // getter functions
+        int getPower(std::size_t lane) const {return m_power[lane];}
+        int getTurnsSurvived(std::size_t lane) const {return m_turnsSurvived[lane];}
+        int getPowerHarvested(std::size_t lane) const {return m_powerHarvested[lane];}
+        Coordinates getCoordinates(std::size_t lane) const {return Coordinates {m_position[lane] / m_grid.rowLength(), m_position[lane] % m_grid.rowLength()};}
+};
+
+#endif
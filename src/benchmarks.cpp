@@ -0,0 +1,842 @@
+// benchmarks for the genetic algorithm
+// every benchmark builds its input from a fixed seed and does a fixed amount of work,
+// so two builds can be compared by running both with the same options
+// results are written as JSON, the checksum of a benchmark only changes if the work does
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+#include <exception>
+#include <algorithm>
+#include <functional>
+
+#include "chunked_evaluation.h"
+#include "counter_rng.h"
+#include "cycle_tracker.h"
+#include "evaluation_arena.h"
+#include "genetic_algorithm.h"
+#include "genome.h"
+#include "grid.h"
+#include "map.h"
+#include "population.h"
+#include "rng.h"
+#include "selection.h"
+#include "steady_state.h"
+#include "robot.h"
+#include "rule_genome.h"
+#include "rule_index.h"
+#include "thread_pool.h"
+
+using BenchmarkGrid = DefaultGrid;
+constexpr std::size_t BENCHMARK_GENE_COUNT {DEFAULT_GENE_COUNT};
+using BenchmarkPopulation = Population<BenchmarkGrid, BENCHMARK_GENE_COUNT>;
+using BenchmarkArena = EvaluationArena<BenchmarkGrid, BENCHMARK_GENE_COUNT>;
+
+struct BenchmarkOptions
+{
+    std::uint32_t seed {12345};
+
+    // each benchmark is run this many times and the fastest run is reported
+    std::size_t repetitions {3};
+
+    // smaller inputs and fewer configurations, for a quick check that everything runs
+    bool quick {false};
+
+    // only run benchmarks whose name contains this
+    std::string filter {};
+
+    // write the JSON here instead of to the console
+    std::string outputPath {};
+};
+
+// one line of the report
+struct BenchmarkResult
+{
+    std::string name {};
+    // parameters as already formatted JSON members, like "\"threads\": 4"
+    std::vector<std::string> parameters {};
+    // how many items (steps, layouts, generations...) one run processes
+    std::uint64_t items {};
+    std::string unit {};
+    double bestSeconds {};
+    double meanSeconds {};
+    std::uint64_t checksum {};
+};
+
+// a run returns how long the part being measured took and a checksum of its result
+struct RunTiming
+{
+    double seconds {};
+    std::uint64_t checksum {};
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Function Prototypes
+bool parseOptions(int argc, char* argv[], BenchmarkOptions& options);
+bool isSelected(const BenchmarkOptions& options, const std::string& name);
+double secondsSince(Clock::time_point start);
+std::string parameter(const std::string& key, std::uint64_t value);
+std::string parameter(const std::string& key, bool value);
+std::string parameter(const std::string& key, const std::string& value);
+BenchmarkResult measure(const BenchmarkOptions& options, const std::string& name, std::vector<std::string> parameters, std::uint64_t items, const std::string& unit, const std::function<RunTiming()>& run);
+BenchmarkPopulation evaluatedPopulation(std::size_t size, std::uint32_t seed);
+void benchmarkSteps(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results);
+void benchmarkMapConstruction(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results);
+void benchmarkSortAndCull(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results);
+void benchmarkSelection(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results);
+void benchmarkLifeSeeds(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results);
+void benchmarkRuleMatching(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results);
+void benchmarkBreeding(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results);
+void benchmarkGenerations(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results);
+void benchmarkEngine(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results);
+void benchmarkChunked(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results);
+void benchmarkSteadyState(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results);
+// the same number of generations as the generations benchmark without the generations,
+// compare the two by robots scored per second
+// with more than one thread the children come back in whatever order the threads finish,
+// so only the single thread checksum is repeatable and the others are left at 0
+void benchmarkSteadyState(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+{
+    if (!isSelected(options, "steady_state"))
+        return;
+
+    std::size_t generationCount {options.quick ? std::size_t {5} : std::size_t {20}};
+    std::vector<std::size_t> sizes {200, 2000};
+    if (!options.quick)
+        sizes.push_back(20000);
+
+    std::vector<std::size_t> threadCounts {1};
+    std::size_t cores {std::max<std::size_t>(std::thread::hardware_concurrency(), 1)};
+    for (std::size_t threads {2}; threads < cores && !options.quick; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    if (cores > 1)
+        threadCounts.push_back(cores);
+
+    for (std::size_t size : sizes)
+    {
+        for (std::size_t threadCount : threadCounts)
+        {
+            SteadyStateSettings settings {};
+            settings.workerCount = threadCount;
+            settings.populationSize = size;
+            settings.generations = static_cast<int>(generationCount);
+
+            std::vector<std::string> parameters {parameter("population", std::uint64_t {size}), parameter("threads", std::uint64_t {threadCount}),
+                                                 parameter("generations", std::uint64_t {generationCount}), parameter("batch_size", std::uint64_t {settings.batchSize})};
+            std::uint64_t robotCount {size + (generationCount - 1) * (size / 2)};
+
+            results.push_back(measure(options, "steady_state", parameters, robotCount, "robots/s", [&]()
+            {
+                Rng rng {options.seed};
+                SteadyStateModel<BenchmarkGrid, BENCHMARK_GENE_COUNT> model {BenchmarkGrid {}, settings, {}, rng};
+
+                Clock::time_point start {Clock::now()};
+                model.run();
+                RunTiming timing {secondsSince(start), 0};
+
+                const SteadyStatePopulation<BENCHMARK_GENE_COUNT>& population {model.getPopulation()};
+                if (threadCount == 1)
+                {
+                    for (std::size_t report {0}; report < population.getReportCount(); ++report)
+                    {
+                        timing.checksum += static_cast<std::uint64_t>(population.getAverageFitness(report));
+                    }
+                }
+                return timing;
+            }));
+        }
+    }
+}
+
+void writeJson(std::ostream& out, const BenchmarkOptions& options, const std::vector<BenchmarkResult>& results);
+
+int main(int argc, char* argv[])
+{
+    BenchmarkOptions options {};
+
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cerr << "Usage: " << argv[0] << " [--seed <number>] [--repetitions <count>] [--quick] [--filter <name>] [--output <file.json>]\n";
+        return 1;
+    }
+
+    std::vector<BenchmarkResult> results {};
+    benchmarkSteps(options, results);
+    benchmarkMapConstruction(options, results);
+    benchmarkSortAndCull(options, results);
+    benchmarkSelection(options, results);
+    benchmarkLifeSeeds(options, results);
+    benchmarkRuleMatching(options, results);
+    benchmarkBreeding(options, results);
+    benchmarkGenerations(options, results);
+    benchmarkEngine(options, results);
+    benchmarkChunked(options, results);
+    benchmarkSteadyState(options, results);
+
+    if (options.outputPath.empty())
+    {
+        writeJson(std::cout, options, results);
+        return 0;
+    }
+
+    std::ofstream out {options.outputPath};
+    if (!out)
+    {
+        std::cerr << "Could not open " << options.outputPath << '\n';
+        return 1;
+    }
+    writeJson(out, options, results);
+    return 0;
+}
+
+// fills in options from the command line, returns false if something is wrong
+bool parseOptions(int argc, char* argv[], BenchmarkOptions& options)
+{
+    try
+    {
+        for (int i {1}; i < argc; ++i)
+        {
+            std::string argument {argv[i]};
+
+            if (argument == "--seed" && i + 1 < argc)
+            {
+                options.seed = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (argument == "--repetitions" && i + 1 < argc)
+            {
+                options.repetitions = static_cast<std::size_t>(std::stoul(argv[++i]));
+                if (options.repetitions == 0)
+                    options.repetitions = 1;
+            }
+            else if (argument == "--quick")
+            {
+                options.quick = true;
+            }
+            else if (argument == "--filter" && i + 1 < argc)
+            {
+                options.filter = argv[++i];
+            }
+            else if (argument == "--output" && i + 1 < argc)
+            {
+                options.outputPath = argv[++i];
+            }
+            else
+            {
+                return false;
+            }
+        }
+    }
+    catch (const std::exception&)
+    {
+        // not a number
+        return false;
+    }
+    return true;
+}
+
+bool isSelected(const BenchmarkOptions& options, const std::string& name)
+{
+    return name.find(options.filter) != std::string::npos;
+}
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::string parameter(const std::string& key, std::uint64_t value)
+{
+    return "\"" + key + "\": " + std::to_string(value);
+}
+
+std::string parameter(const std::string& key, bool value)
+{
+    return "\"" + key + "\": " + (value ? "true" : "false");
+}
+
+std::string parameter(const std::string& key, const std::string& value)
+{
+    return "\"" + key + "\": \"" + value + "\"";
+}
+
+// runs a benchmark options.repetitions times
+// every run gets the same input, so every run has to give the same checksum
+BenchmarkResult measure(const BenchmarkOptions& options, const std::string& name, std::vector<std::string> parameters, std::uint64_t items, const std::string& unit, const std::function<RunTiming()>& run)
+{
+    BenchmarkResult result {};
+    result.name = name;
+    result.parameters = std::move(parameters);
+    result.items = items;
+    result.unit = unit;
+
+    double totalSeconds {};
+    for (std::size_t i {0}; i < options.repetitions; ++i)
+    {
+        RunTiming timing {run()};
+
+        if (i == 0 || timing.seconds < result.bestSeconds)
+            result.bestSeconds = timing.seconds;
+        totalSeconds += timing.seconds;
+
+        if (i > 0 && timing.checksum != result.checksum)
+            std::cerr << "warning: " << name << " did different work between runs\n";
+        result.checksum = timing.checksum;
+    }
+    result.meanSeconds = totalSeconds / static_cast<double>(options.repetitions);
+
+    std::cerr << name << ": " << static_cast<double>(items) / result.bestSeconds << ' ' << unit << '\n';
+    return result;
+}
+
+// a population that has been through one evaluation, ready to be sorted and culled
+BenchmarkPopulation evaluatedPopulation(std::size_t size, std::uint32_t seed)
+{
+    Rng rng {seed};
+    ThreadPool pool {1};
+    std::vector<BenchmarkArena> arenas(1);
+
+    LayoutSource<BenchmarkGrid> layouts {BenchmarkGrid {}, 0, rng};
+    BenchmarkPopulation robots {size, layouts, rng};
+    evaluateRobots(robots, pool, LifeSeeds {CounterRng {seed}, 0}, arenas, layouts, 1, false);
+    return robots;
+}
+
+// updateSensor() + update() until every robot runs out of power, then the same lives
+// through Robot::runLife() which skips ahead once a robot is stuck in a loop
+// both give the same checksum since they have to end up in the same place
+// the robots are built before the clock starts so only the steps are timed
+void benchmarkSteps(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+{
+    if (!isSelected(options, "robot_steps") && !isSelected(options, "robot_lives"))
+        return;
+
+    std::size_t robotCount {options.quick ? std::size_t {2000} : std::size_t {50000}};
+    Rng setupRng {options.seed};
+    LayoutSource<BenchmarkGrid> layouts {BenchmarkGrid {}, 0, setupRng};
+    BenchmarkPopulation robots {robotCount, layouts, setupRng};
+    CycleTracker<BenchmarkGrid> cycles {};
+
+    // count the steps once so the rate is in steps per second
+    std::uint64_t stepCount {};
+    auto simulate = [&](bool fastForward)
+    {
+        std::vector<BenchmarkPopulation::RobotType> lives {};
+        lives.reserve(robots.size());
+        for (std::size_t i {0}; i < robots.size(); ++i)
+        {
+            lives.push_back(robots.getRobot(i));
+        }
+
+        Rng rng {options.seed};
+        Clock::time_point start {Clock::now()};
+        for (BenchmarkPopulation::RobotType& robot : lives)
+        {
+            if (fastForward)
+            {
+                robot.runLife(rng, cycles);
+                continue;
+            }
+
+            while (robot.getPower() != 0)
+            {
+                robot.updateSensor();
+                robot.update(rng);
+            }
+        }
+        double seconds {secondsSince(start)};
+
+        RunTiming timing {seconds, 0};
+        std::uint64_t steps {0};
+        for (const BenchmarkPopulation::RobotType& robot : lives)
+        {
+            timing.checksum += static_cast<std::uint64_t>(robot.getTurnsSurvived()) * 131 + static_cast<std::uint64_t>(robot.getCoordinates().x * 17 + robot.getCoordinates().y);
+            steps += static_cast<std::uint64_t>(robot.getTurnsSurvived());
+        }
+        stepCount = steps;
+        return timing;
+    };
+
+    // the step count is only known after a run, so do one before measuring
+    simulate(false);
+
+    if (isSelected(options, "robot_steps"))
+        results.push_back(measure(options, "robot_steps", {parameter("robots", std::uint64_t {robotCount})}, stepCount, "steps/s", [&]() {return simulate(false);}));
+    if (isSelected(options, "robot_lives"))
+        results.push_back(measure(options, "robot_lives", {parameter("robots", std::uint64_t {robotCount})}, stepCount, "steps/s", [&]() {return simulate(true);}));
+}
+
+// building layouts and the robots' maps on top of them
+void benchmarkMapConstruction(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+{
+    std::size_t layoutCount {options.quick ? std::size_t {2000} : std::size_t {100000}};
+
+    if (isSelected(options, "layout_generate"))
+    {
+        results.push_back(measure(options, "layout_generate", {parameter("layouts", std::uint64_t {layoutCount})}, layoutCount, "layouts/s", [&]()
+        {
+            Rng rng {options.seed};
+            BatteryLayout<BenchmarkGrid> layout {};
+            RunTiming timing {};
+
+            Clock::time_point start {Clock::now()};
+            for (std::size_t i {0}; i < layoutCount; ++i)
+            {
+                layout.generate(rng.nextSeed());
+                timing.checksum += static_cast<std::uint64_t>(layout.getCode(1, 1));
+            }
+            timing.seconds = secondsSince(start);
+            return timing;
+        }));
+    }
+
+    // a pregenerated pool of shared layouts built on every core
+    if (isSelected(options, "layout_pool"))
+    {
+        std::size_t cores {std::max<std::size_t>(std::thread::hardware_concurrency(), 1)};
+        results.push_back(measure(options, "layout_pool", {parameter("layouts", std::uint64_t {layoutCount}), parameter("threads", std::uint64_t {cores})}, layoutCount, "layouts/s", [&]()
+        {
+            Rng rng {options.seed};
+            ThreadPool pool {cores};
+
+            Clock::time_point start {Clock::now()};
+            LayoutSource<BenchmarkGrid> layouts {BenchmarkGrid {}, layoutCount, rng, &pool};
+            RunTiming timing {secondsSince(start), 0};
+
+            timing.checksum = layouts.getSharedLayoutCount() + static_cast<std::uint64_t>(layouts.nextLayout(rng)->getCode(1, 1));
+            return timing;
+        }));
+    }
+
+    if (isSelected(options, "robot_construct"))
+    {
+        // a small pool of layouts and genomes so the compiler can't build one robot and reuse it
+        constexpr std::size_t POOL_SIZE {64};
+        Rng setupRng {options.seed};
+        std::vector<BatteryLayout<BenchmarkGrid>> layouts {};
+        std::vector<Genome<BENCHMARK_GENE_COUNT>> genomes {};
+        std::vector<Coordinates> spawns {};
+        for (std::size_t i {0}; i < POOL_SIZE; ++i)
+        {
+            layouts.emplace_back(BenchmarkGrid {}, setupRng.nextSeed());
+            genomes.push_back(Genome<BENCHMARK_GENE_COUNT>::random(setupRng));
+            spawns.push_back(layouts.back().spawnRobot(setupRng));
+        }
+
+        results.push_back(measure(options, "robot_construct", {parameter("robots", std::uint64_t {layoutCount})}, layoutCount, "robots/s", [&]()
+        {
+            Rng rng {options.seed};
+            RunTiming timing {};
+
+            Clock::time_point start {Clock::now()};
+            for (std::size_t i {0}; i < layoutCount; ++i)
+            {
+                // one step so the map and the compiled genes are actually used
+                BenchmarkPopulation::RobotType robot {genomes[i % POOL_SIZE], layouts[(i / POOL_SIZE) % POOL_SIZE], spawns[(i / POOL_SIZE) % POOL_SIZE]};
+                robot.updateSensor();
+                robot.update(rng);
+                timing.checksum += static_cast<std::uint64_t>(robot.getPower() + robot.getCoordinates().x * 11 + robot.getCoordinates().y);
+            }
+            timing.seconds = secondsSince(start);
+            return timing;
+        }));
+    }
+}
+
+// sortVector() then destroyBottom50Percent() on a freshly evaluated population
+void benchmarkSortAndCull(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+{
+    if (!isSelected(options, "sort_and_cull"))
+        return;
+
+    std::vector<std::size_t> sizes {200, 20000};
+    if (!options.quick)
+        sizes.push_back(200000);
+
+    for (std::size_t size : sizes)
+    {
+        BenchmarkPopulation evaluated {evaluatedPopulation(size, options.seed)};
+
+        results.push_back(measure(options, "sort_and_cull", {parameter("population", std::uint64_t {size})}, size, "robots/s", [&]()
+        {
+            BenchmarkPopulation robots {evaluated};
+
+            Clock::time_point start {Clock::now()};
+            sortVector(robots);
+            destroyBottom50Percent(robots);
+            RunTiming timing {secondsSince(start), 0};
+
+            timing.checksum = robots.size() + static_cast<std::uint64_t>(robots.getFitness(0));
+            return timing;
+        }));
+    }
+}
+
+// picking half of the population as parents with every selection scheme
+// only the fitness array is used, so it is made up instead of evaluating millions of robots
+void benchmarkSelection(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+{
+    if (!isSelected(options, "selection"))
+        return;
+
+    std::vector<std::size_t> sizes {200, 20000};
+    if (!options.quick)
+        sizes.push_back(2000000);
+
+    for (const char* name : {"truncation", "tournament", "roulette", "sus", "rank"})
+    {
+        SelectionSettings settings {};
+        parseSelectionScheme(name, settings.scheme);
+
+        for (std::size_t size : sizes)
+        {
+            // fitness is harvested power, so whole numbers with plenty of ties
+            Rng fitnessRng {options.seed};
+            std::vector<double> fitness(size);
+            for (double& value : fitness)
+            {
+                value = static_cast<double>(fitnessRng.nextInt(200));
+            }
+
+            results.push_back(measure(options, "selection", {parameter("scheme", std::string {name}), parameter("population", std::uint64_t {size})}, size, "robots/s", [&]()
+            {
+                Selector selector {settings};
+                Rng rng {options.seed};
+
+                Clock::time_point start {Clock::now()};
+                const std::vector<std::size_t>& parents {selector.select(fitness, size, size / 2, rng)};
+                RunTiming timing {secondsSince(start), 0};
+
+                for (std::size_t parent : parents)
+                {
+                    timing.checksum += parent;
+                }
+                return timing;
+            }));
+        }
+    }
+}
+
+// looking up a generation's life seeds, one at a time the way the process workers do
+// and a whole range at once the way the arenas do
+void benchmarkLifeSeeds(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+{
+    if (!isSelected(options, "life_seeds"))
+        return;
+
+    std::size_t size {options.quick ? std::size_t {20000} : std::size_t {2000000}};
+    CounterRng lifeRng {options.seed};
+
+    for (const char* mode : {"at", "fill"})
+    {
+        bool filled {std::string {mode} == "fill"};
+        results.push_back(measure(options, "life_seeds", {parameter("mode", std::string {mode}), parameter("population", std::uint64_t {size})}, size, "seeds/s", [&]()
+        {
+            LifeSeeds seeds {lifeRng, 1};
+            std::vector<std::uint32_t> out(size);
+
+            Clock::time_point start {Clock::now()};
+            if (filled)
+            {
+                seeds.fill(0, size, out.data());
+            }
+            else
+            {
+                for (std::size_t i {0}; i < size; ++i)
+                {
+                    out[i] = seeds.at(i);
+                }
+            }
+            RunTiming timing {secondsSince(start), 0};
+
+            for (std::uint32_t seed : out)
+            {
+                timing.checksum += seed;
+            }
+            return timing;
+        }));
+    }
+}
+
+// picking the rule for a sensor reading with the compiled index and with a scan of every
+// rule, the checksums of the two have to agree
+void benchmarkRuleMatching(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+{
+    if (!isSelected(options, "rule_matching"))
+        return;
+
+    std::size_t readingCount {options.quick ? std::size_t {4096} : std::size_t {65536}};
+    std::vector<std::size_t> ruleCounts {16, 256};
+    if (!options.quick)
+        ruleCounts.push_back(4096);
+
+    for (std::size_t sensorCount : {std::size_t {4}, std::size_t {8}, std::size_t {12}})
+    {
+        // readings are random codes, a real map would match the early rules more often
+        Rng readingRng {options.seed};
+        std::vector<std::uint8_t> readings(readingCount * sensorCount);
+        for (std::uint8_t& code : readings)
+        {
+            code = static_cast<std::uint8_t>(readingRng.nextInt(3));
+        }
+
+        for (std::size_t ruleCount : ruleCounts)
+        {
+            Rng rng {options.seed};
+            RuleGenome genome {RuleGenome::random(ruleCount, sensorCount, rng)};
+            RuleIndex index {genome};
+
+            for (const char* method : {"index", "scan"})
+            {
+                bool indexed {std::string {method} == "index"};
+                std::vector<std::string> parameters {parameter("method", std::string {method}), parameter("sensors", std::uint64_t {sensorCount}), parameter("rules", std::uint64_t {ruleCount})};
+
+                results.push_back(measure(options, "rule_matching", parameters, readingCount, "matches/s", [&]()
+                {
+                    RunTiming timing {};
+                    Clock::time_point start {Clock::now()};
+                    for (std::size_t i {0}; i < readingCount; ++i)
+                    {
+                        const std::uint8_t* reading {&readings[i * sensorCount]};
+                        timing.checksum += indexed ? index.firstMatch(reading) : genome.firstMatch(reading);
+                    }
+                    timing.seconds = secondsSince(start);
+                    return timing;
+                }));
+            }
+        }
+    }
+}
+
+// breedRobots() on the survivors of a sorted and culled population
+void benchmarkBreeding(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+{
+    if (!isSelected(options, "breed_robots"))
+        return;
+
+    std::vector<std::size_t> sizes {200, 20000};
+    if (!options.quick)
+        sizes.push_back(200000);
+
+    for (std::size_t sharedLayoutCount : {std::size_t {0}, std::size_t {16}})
+    {
+        for (std::size_t size : sizes)
+        {
+            BenchmarkPopulation survivors {evaluatedPopulation(size, options.seed)};
+            sortVector(survivors);
+            destroyBottom50Percent(survivors);
+
+            Rng layoutRng {options.seed};
+            LayoutSource<BenchmarkGrid> layouts {BenchmarkGrid {}, sharedLayoutCount, layoutRng};
+
+            results.push_back(measure(options, "breed_robots", {parameter("population", std::uint64_t {size}), parameter("shared_layouts", std::uint64_t {sharedLayoutCount})}, survivors.size(), "children/s", [&]()
+            {
+                BenchmarkPopulation robots {survivors};
+                robots.reserve(size);
+                Rng rng {options.seed};
+
+                Clock::time_point start {Clock::now()};
+                breedRobots(robots, layouts, rng);
+                RunTiming timing {secondsSince(start), 0};
+
+                const Genome<BENCHMARK_GENE_COUNT>& lastChild {robots.getGenome(robots.size() - 1)};
+                timing.checksum = robots.size() + lastChild.getWords()[0];
+                return timing;
+            }));
+        }
+    }
+}
+
+// whole generations: evaluate, sort, cull and breed, the same loop main() runs
+void benchmarkGenerations(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+{
+    if (!isSelected(options, "generations"))
+        return;
+
+    std::size_t generationCount {options.quick ? std::size_t {5} : std::size_t {20}};
+    std::vector<std::size_t> sizes {200, 2000};
+    if (!options.quick)
+        sizes.push_back(20000);
+
+    std::vector<std::size_t> threadCounts {1};
+    std::size_t cores {std::max<std::size_t>(std::thread::hardware_concurrency(), 1)};
+    for (std::size_t threads {2}; threads < cores && !options.quick; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    if (cores > 1)
+        threadCounts.push_back(cores);
+
+    for (std::size_t size : sizes)
+    {
+        for (std::size_t threadCount : threadCounts)
+        {
+            for (bool batched : {false, true})
+            {
+                std::vector<std::string> parameters {parameter("population", std::uint64_t {size}), parameter("threads", std::uint64_t {threadCount}),
+                                                     parameter("batched", batched), parameter("generations", std::uint64_t {generationCount})};
+
+                results.push_back(measure(options, "generations", parameters, generationCount, "generations/s", [&]()
+                {
+                    // everything is rebuilt from the seed so every run does the same work
+                    Rng rng {options.seed};
+                    ThreadPool pool {threadCount};
+
+                    CounterRng lifeRng {options.seed};
+                    std::vector<BenchmarkArena> arenas(pool.size());
+
+                    LayoutSource<BenchmarkGrid> layouts {BenchmarkGrid {}, 0, rng};
+                    BenchmarkPopulation robots {size, layouts, rng};
+
+                    Clock::time_point start {Clock::now()};
+                    for (std::size_t generation {0}; generation < generationCount; ++generation)
+                    {
+                        evaluateRobots(robots, pool, LifeSeeds {lifeRng, static_cast<std::uint32_t>(generation)}, arenas, layouts, 1, batched);
+                        sortVector(robots);
+                        destroyBottom50Percent(robots);
+                        breedRobots(robots, layouts, rng);
+                    }
+                    RunTiming timing {secondsSince(start), 0};
+
+                    for (std::size_t i {0}; i < robots.size(); ++i)
+                    {
+                        timing.checksum += static_cast<std::uint64_t>(robots.getFitness(i));
+                    }
+                    return timing;
+                }));
+            }
+        }
+    }
+}
+
+// the generations benchmark on one thread run through RobotEngine instead of the free functions
+// the checksums match the single thread, unbatched generations runs, so any gap in time
+// is what the policies cost
+void benchmarkEngine(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+{
+    if (!isSelected(options, "engine_generations"))
+        return;
+
+    std::size_t generationCount {options.quick ? std::size_t {5} : std::size_t {20}};
+    std::vector<std::size_t> sizes {200, 2000};
+    if (!options.quick)
+        sizes.push_back(20000);
+
+    for (std::size_t size : sizes)
+    {
+        std::vector<std::string> parameters {parameter("population", std::uint64_t {size}), parameter("threads", std::uint64_t {1}),
+                                             parameter("batched", false), parameter("generations", std::uint64_t {generationCount})};
+
+        results.push_back(measure(options, "engine_generations", parameters, generationCount, "generations/s", [&]()
+        {
+            Rng rng {options.seed};
+            ThreadPool pool {1};
+
+            std::vector<BenchmarkArena> arenas(pool.size());
+
+            LayoutSource<BenchmarkGrid> layouts {BenchmarkGrid {}, 0, rng};
+            BenchmarkPopulation robots {size, layouts, rng};
+            RobotEngine<BenchmarkGrid, BENCHMARK_GENE_COUNT> engine {RobotEvaluator<BenchmarkGrid, BENCHMARK_GENE_COUNT> {pool, CounterRng {options.seed}, arenas, layouts, 1, false}};
+
+            Clock::time_point start {Clock::now()};
+            for (std::size_t generation {0}; generation < generationCount; ++generation)
+            {
+                engine.step(robots, rng);
+            }
+            RunTiming timing {secondsSince(start), 0};
+
+            for (std::size_t i {0}; i < robots.size(); ++i)
+            {
+                timing.checksum += static_cast<std::uint64_t>(robots.getFitness(i));
+            }
+            return timing;
+        }));
+    }
+}
+
+// the engine on a population that only keeps genomes, simulated a chunk at a time, next to
+// engine_generations on the same sizes
+void benchmarkChunked(const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+{
+    if (!isSelected(options, "chunked_generations"))
+        return;
+
+    std::size_t generationCount {options.quick ? std::size_t {5} : std::size_t {20}};
+    std::vector<std::size_t> sizes {200, 2000};
+    if (!options.quick)
+        sizes.push_back(20000);
+
+    for (std::size_t size : sizes)
+    {
+        for (std::size_t chunkSize : {std::size_t {256}, std::size_t {4096}})
+        {
+            std::vector<std::string> parameters {parameter("population", std::uint64_t {size}), parameter("chunk", std::uint64_t {chunkSize}),
+                                                 parameter("generations", std::uint64_t {generationCount})};
+
+            results.push_back(measure(options, "chunked_generations", parameters, generationCount, "generations/s", [&]()
+            {
+                Rng rng {options.seed};
+                ThreadPool pool {1};
+
+                std::vector<BenchmarkArena> arenas(pool.size());
+
+                LayoutSource<BenchmarkGrid> layouts {BenchmarkGrid {}, 0, rng};
+                GenomePopulation<Genome<BENCHMARK_GENE_COUNT>> robots {size, [&rng]() {return Genome<BENCHMARK_GENE_COUNT>::random(rng);}};
+                ChunkedEngine<BenchmarkGrid, BENCHMARK_GENE_COUNT> engine {ChunkedEvaluator<BenchmarkGrid, BENCHMARK_GENE_COUNT> {pool, CounterRng {options.seed}, arenas, layouts, 1, false, chunkSize}};
+
+                Clock::time_point start {Clock::now()};
+                for (std::size_t generation {0}; generation < generationCount; ++generation)
+                {
+                    engine.step(robots, rng);
+                }
+                RunTiming timing {secondsSince(start), 0};
+
+                for (std::size_t i {0}; i < robots.size(); ++i)
+                {
+                    timing.checksum += static_cast<std::uint64_t>(robots.getFitness(i));
+                }
+                return timing;
+            }));
+        }
+    }
+}
+
+void writeJson(std::ostream& out, const BenchmarkOptions& options, const std::vector<BenchmarkResult>& results)
+{
+    out.precision(9);
+    out << "{\n";
+    out << "  \"seed\": " << options.seed << ",\n";
+    out << "  \"repetitions\": " << options.repetitions << ",\n";
+    out << "  \"quick\": " << (options.quick ? "true" : "false") << ",\n";
+    out << "  \"vector_lanes\": " << BatchSimulator<BenchmarkGrid>::LANES << ",\n";
+    out << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    out << "  \"benchmarks\": [\n";
+
+    for (std::size_t i {0}; i < results.size(); ++i)
+    {
+        const BenchmarkResult& result {results[i]};
+
+        out << "    {\"name\": \"" << result.name << "\", \"parameters\": {";
+        for (std::size_t j {0}; j < result.parameters.size(); ++j)
+        {
+            out << (j == 0 ? "" : ", ") << result.parameters[j];
+        }
+        out << "}, \"items\": " << result.items
+            << ", \"best_seconds\": " << result.bestSeconds
+            << ", \"mean_seconds\": " << result.meanSeconds
+            << ", \"rate\": " << static_cast<double>(result.items) / result.bestSeconds
+            << ", \"unit\": \"" << result.unit << "\""
+            << ", \"checksum\": " << result.checksum << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+
+    out << "  ]\n";
+    out << "}\n";
+}
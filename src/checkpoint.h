@@ -0,0 +1,388 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "genome.h"
+#include "map.h"
+#include "population.h"
+#include "rng.h"
+#include "selection.h"
+
+// saved runs
+// a checkpoint is a fixed size header followed by one flat array per field, each starting
+// on an 8 byte boundary, so a file can be mapped into memory and read in place
+// numbers are stored in the machine's own byte order
+//
+// a checkpoint is taken between generations, after breeding, and holds everything the
+// next generation depends on, so a resumed run prints exactly what the original would have
+
+constexpr char CHECKPOINT_MAGIC[8] {'G', 'A', 'C', 'K', 'P', 'T', '\0', '\0'};
+// version 2 dropped the workers' random states, life seeds are looked up by generation now
+// version 3 added the fixed evaluation, version 4 the selection scheme, version 5 the
+// mutation chance
+constexpr std::uint32_t CHECKPOINT_VERSION {5};
+
+// the options of a saved run that a resumed run has to take over to carry on the same way
+struct CheckpointSettings
+{
+    std::uint32_t seed {};
+    std::size_t trials {1};
+
+    // every robot is scored on the same trials made from evaluationSeed, with the scores
+    // of up to fitnessCacheSize genomes remembered
+    bool fixedEvaluation {false};
+    std::uint32_t evaluationSeed {};
+    std::size_t fitnessCacheSize {0};
+
+    // how the parents of each generation are picked and how often a child is mutated
+    SelectionSettings selection {};
+    int mutationPercent {DEFAULT_MUTATION_PERCENT};
+};
+
+struct CheckpointHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t headerSize;
+    std::uint64_t fileSize;
+
+    // the run that was saved
+    std::uint32_t seed;
+    std::uint32_t geneCount;
+    std::int32_t width;
+    std::int32_t height;
+    std::int32_t batteryPercent;
+    std::uint32_t wordsPerGenome;
+    std::uint64_t trials;
+    // the generation the run carries on from
+    std::uint64_t generation;
+    std::uint64_t robotCount;
+    std::uint64_t sharedLayoutCount;
+    // 1 if every robot was scored on the trials made from evaluationSeed
+    std::uint32_t fixedEvaluation;
+    std::uint32_t evaluationSeed;
+    std::uint64_t fitnessCacheSize;
+    // a SelectionScheme and its settings
+    std::uint32_t selectionScheme;
+    std::int32_t mutationPercent;
+    std::uint64_t tournamentSize;
+    double rankPressure;
+
+    Rng::State mainRng;
+
+    // where each array starts, counted in bytes from the start of the file
+    std::uint64_t sharedSeedsOffset;        // sharedLayoutCount uint32
+    std::uint64_t genomesOffset;            // robotCount * wordsPerGenome uint64
+    std::uint64_t layoutSeedsOffset;        // robotCount uint32
+    std::uint64_t coordinatesOffset;        // robotCount Coordinates
+    std::uint64_t powerOffset;              // robotCount int32
+    std::uint64_t turnsSurvivedOffset;      // robotCount int32
+    std::uint64_t powerHarvestedOffset;     // robotCount int32
+    std::uint64_t fitnessOffset;            // robotCount double
+    std::uint64_t fitnessMinOffset;         // robotCount int32
+    std::uint64_t fitnessVarianceOffset;    // robotCount double
+};
+
+static_assert(std::is_trivially_copyable<CheckpointHeader>::value, "the header is written and mapped as raw bytes");
+static_assert(std::is_trivially_copyable<Coordinates>::value && sizeof(Coordinates) == 8, "coordinates are stored as two 32 bit numbers");
+
+// a checkpoint file mapped read only
+// open() checks the header, that every array fits inside the file, that the run is one
+// parseOptions() would have let through and that every robot and gene can be simulated
+class CheckpointFile
+{
+    private:
+        const std::uint8_t* m_data {nullptr};
+        std::size_t m_size {};
+        std::string m_error {};
+
+        void close()
+        {
+            if (m_data)
+                munmap(const_cast<std::uint8_t*>(m_data), m_size);
+            m_data = nullptr;
+            m_size = 0;
+        }
+
+        bool fits(std::uint64_t offset, std::uint64_t count, std::size_t elementSize) const
+        {
+            return offset % 8 == 0 && offset <= m_size && count <= (m_size - offset) / elementSize;
+        }
+
+        bool fail(const std::string& error)
+        {
+            m_error = error;
+            close();
+            return false;
+        }
+    public:
+        CheckpointFile() = default;
+        CheckpointFile(const CheckpointFile&) = delete;
+        CheckpointFile& operator=(const CheckpointFile&) = delete;
+
+        ~CheckpointFile()
+        {
+            close();
+        }
+
+        bool open(const std::string& path)
+        {
+            close();
+
+            int descriptor {::open(path.c_str(), O_RDONLY)};
+            if (descriptor < 0)
+                return fail("could not open " + path);
+
+            struct stat status {};
+            if (fstat(descriptor, &status) != 0 || static_cast<std::size_t>(status.st_size) < sizeof(CheckpointHeader))
+            {
+                ::close(descriptor);
+                return fail(path + " is too small to be a checkpoint");
+            }
+
+            m_size = static_cast<std::size_t>(status.st_size);
+            void* mapping {mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, descriptor, 0)};
+            ::close(descriptor);
+            if (mapping == MAP_FAILED)
+            {
+                m_size = 0;
+                return fail("could not map " + path);
+            }
+            m_data = static_cast<const std::uint8_t*>(mapping);
+
+            const CheckpointHeader& saved {header()};
+            if (std::memcmp(saved.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0)
+                return fail(path + " is not a checkpoint");
+            if (saved.version != CHECKPOINT_VERSION || saved.headerSize != sizeof(CheckpointHeader))
+                return fail(path + " is checkpoint version " + std::to_string(saved.version) + ", this build reads version " + std::to_string(CHECKPOINT_VERSION));
+            if (saved.fileSize != m_size)
+                return fail(path + " is cut short");
+
+            std::uint64_t robots {saved.robotCount};
+            bool valid {fits(saved.sharedSeedsOffset, saved.sharedLayoutCount, sizeof(std::uint32_t))
+                        && saved.wordsPerGenome != 0 && robots <= m_size
+                        && fits(saved.genomesOffset, robots * saved.wordsPerGenome, sizeof(std::uint64_t))
+                        && fits(saved.layoutSeedsOffset, robots, sizeof(std::uint32_t))
+                        && fits(saved.coordinatesOffset, robots, sizeof(Coordinates))
+                        && fits(saved.powerOffset, robots, sizeof(std::int32_t))
+                        && fits(saved.turnsSurvivedOffset, robots, sizeof(std::int32_t))
+                        && fits(saved.powerHarvestedOffset, robots, sizeof(std::int32_t))
+                        && fits(saved.fitnessOffset, robots, sizeof(double))
+                        && fits(saved.fitnessMinOffset, robots, sizeof(std::int32_t))
+                        && fits(saved.fitnessVarianceOffset, robots, sizeof(double))};
+            if (!valid)
+                return fail(path + " is damaged");
+
+            // the same bounds as the command line, a resumed run takes these from the file
+            if (saved.width < 1 || saved.height < 1)
+                return fail(path + " has a " + std::to_string(saved.width) + "x" + std::to_string(saved.height) + " grid");
+            if (saved.batteryPercent < 0 || saved.batteryPercent > 99)
+                return fail(path + " has " + std::to_string(saved.batteryPercent) + " percent batteries");
+            if (saved.trials == 0)
+                return fail(path + " scores robots on 0 trials");
+            if (!isValidPopulationSize(robots))
+                return fail(path + " has " + std::to_string(robots) + " robots, a run needs a multiple of 4");
+            if (saved.generation > static_cast<std::uint64_t>(std::numeric_limits<int>::max()))
+                return fail(path + " is at generation " + std::to_string(saved.generation));
+
+            // every robot has to be inside the walls with no negative counts
+            const Coordinates* coordinates {section<Coordinates>(saved.coordinatesOffset)};
+            const std::int32_t* power {section<std::int32_t>(saved.powerOffset)};
+            const std::int32_t* turnsSurvived {section<std::int32_t>(saved.turnsSurvivedOffset)};
+            const std::int32_t* powerHarvested {section<std::int32_t>(saved.powerHarvestedOffset)};
+            for (std::uint64_t i {0}; i < robots; ++i)
+            {
+                bool inside {coordinates[i].x >= 1 && coordinates[i].x <= saved.height && coordinates[i].y >= 1 && coordinates[i].y <= saved.width};
+                if (!inside)
+                    return fail(path + " has robot " + std::to_string(i) + " at " + std::to_string(coordinates[i].x) + ", " + std::to_string(coordinates[i].y) + ", outside the grid");
+                if (power[i] < 0 || turnsSurvived[i] < 0 || powerHarvested[i] < 0)
+                    return fail(path + " has a negative count for robot " + std::to_string(i));
+            }
+
+            // the genes are compiled into action tables, so a bad code would write past one
+            if (saved.wordsPerGenome * (64 / GENE_BITS) != saved.geneCount)
+                return fail(path + " has " + std::to_string(saved.wordsPerGenome) + " words for " + std::to_string(saved.geneCount) + " genes");
+            const std::uint64_t* words {section<std::uint64_t>(saved.genomesOffset)};
+            for (std::uint64_t i {0}; i < robots * saved.wordsPerGenome; ++i)
+            {
+                for (std::size_t gene {0}; gene < 64 / GENE_BITS; ++gene)
+                {
+                    if (!isValidGene(words[i] >> (gene * GENE_BITS)))
+                        return fail(path + " has a bad gene in robot " + std::to_string(i / saved.wordsPerGenome));
+                }
+            }
+
+            m_error.clear();
+            return true;
+        }
+
+        const std::string& getError() const {return m_error;}
+        const CheckpointHeader& header() const {return *reinterpret_cast<const CheckpointHeader*>(m_data);}
+
+        // one of the arrays, offset comes from the header
+        template <typename T>
+        const T* section(std::uint64_t offset) const {return reinterpret_cast<const T*>(m_data + offset);}
+};
+
+// builds the file in memory then writes it next to the old one and renames it into place,
+// so a run killed halfway through saving still has its previous checkpoint
+template <typename Grid, std::size_t GeneCount>
+bool saveCheckpoint(const std::string& path, const CheckpointSettings& settings, std::uint64_t generation, const Population<Grid, GeneCount>& robots,
+                    const LayoutSource<Grid>& layouts, const Rng& rng)
+{
+    const Grid& grid {layouts.getGrid()};
+    std::vector<std::uint32_t> sharedSeeds {layouts.getSharedSeeds()};
+    std::uint64_t robotCount {robots.size()};
+    std::uint64_t words {Genome<GeneCount>::WORD_COUNT};
+
+    CheckpointHeader header {};
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.version = CHECKPOINT_VERSION;
+    header.headerSize = sizeof(CheckpointHeader);
+    header.seed = settings.seed;
+    header.geneCount = static_cast<std::uint32_t>(GeneCount);
+    header.width = grid.width();
+    header.height = grid.height();
+    header.batteryPercent = grid.batteryPercent();
+    header.wordsPerGenome = static_cast<std::uint32_t>(words);
+    header.trials = settings.trials;
+    header.generation = generation;
+    header.robotCount = robotCount;
+    header.sharedLayoutCount = sharedSeeds.size();
+    header.fixedEvaluation = settings.fixedEvaluation ? 1 : 0;
+    header.evaluationSeed = settings.evaluationSeed;
+    header.fitnessCacheSize = settings.fitnessCacheSize;
+    header.selectionScheme = static_cast<std::uint32_t>(settings.selection.scheme);
+    header.mutationPercent = settings.mutationPercent;
+    header.tournamentSize = settings.selection.tournamentSize;
+    header.rankPressure = settings.selection.rankPressure;
+    header.mainRng = rng.getState();
+
+    // lay the arrays out one after another
+    std::uint64_t end {sizeof(CheckpointHeader)};
+    auto place = [&end](std::uint64_t bytes)
+    {
+        std::uint64_t offset {(end + 7) / 8 * 8};
+        end = offset + bytes;
+        return offset;
+    };
+    header.sharedSeedsOffset = place(header.sharedLayoutCount * sizeof(std::uint32_t));
+    header.genomesOffset = place(robotCount * words * sizeof(std::uint64_t));
+    header.layoutSeedsOffset = place(robotCount * sizeof(std::uint32_t));
+    header.coordinatesOffset = place(robotCount * sizeof(Coordinates));
+    header.powerOffset = place(robotCount * sizeof(std::int32_t));
+    header.turnsSurvivedOffset = place(robotCount * sizeof(std::int32_t));
+    header.powerHarvestedOffset = place(robotCount * sizeof(std::int32_t));
+    header.fitnessOffset = place(robotCount * sizeof(double));
+    header.fitnessMinOffset = place(robotCount * sizeof(std::int32_t));
+    header.fitnessVarianceOffset = place(robotCount * sizeof(double));
+    header.fileSize = (end + 7) / 8 * 8;
+
+    std::vector<std::uint8_t> bytes(static_cast<std::size_t>(header.fileSize));
+    auto write = [&bytes](std::uint64_t offset, std::size_t index, const auto& value)
+    {
+        std::memcpy(&bytes[static_cast<std::size_t>(offset) + index * sizeof(value)], &value, sizeof(value));
+    };
+
+    write(0, 0, header);
+    for (std::size_t i {0}; i < sharedSeeds.size(); ++i)
+    {
+        write(header.sharedSeedsOffset, i, sharedSeeds[i]);
+    }
+    for (std::size_t i {0}; i < robots.size(); ++i)
+    {
+        const std::array<std::uint64_t, Genome<GeneCount>::WORD_COUNT>& genomeWords {robots.getGenome(i).getWords()};
+        for (std::size_t w {0}; w < genomeWords.size(); ++w)
+        {
+            write(header.genomesOffset, i * genomeWords.size() + w, genomeWords[w]);
+        }
+
+        write(header.layoutSeedsOffset, i, robots.getLayout(i).getSeed());
+        write(header.coordinatesOffset, i, robots.getCoordinates(i));
+        write(header.powerOffset, i, static_cast<std::int32_t>(robots.getPower(i)));
+        write(header.turnsSurvivedOffset, i, static_cast<std::int32_t>(robots.getTurnsSurvived(i)));
+        write(header.powerHarvestedOffset, i, static_cast<std::int32_t>(robots.getPowerHarvested(i)));
+        write(header.fitnessOffset, i, robots.getFitness(i));
+        write(header.fitnessMinOffset, i, static_cast<std::int32_t>(robots.getFitnessMin(i)));
+        write(header.fitnessVarianceOffset, i, robots.getFitnessVariance(i));
+    }
+
+    std::string temporaryPath {path + ".tmp"};
+    {
+        std::ofstream out {temporaryPath, std::ios::binary | std::ios::trunc};
+        out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!out)
+            return false;
+    }
+    return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
+
+// the genome of a saved robot
+template <std::size_t GeneCount>
+Genome<GeneCount> savedGenome(const CheckpointFile& file, std::size_t i)
+{
+    return Genome<GeneCount>::fromWords(file.section<std::uint64_t>(file.header().genomesOffset) + i * Genome<GeneCount>::WORD_COUNT);
+}
+
+// the shared layouts of a saved run, to rebuild its LayoutSource from
+inline std::vector<std::uint32_t> savedSharedSeeds(const CheckpointFile& file)
+{
+    const std::uint32_t* seeds {file.section<std::uint32_t>(file.header().sharedSeedsOffset)};
+    return std::vector<std::uint32_t>(seeds, seeds + file.header().sharedLayoutCount);
+}
+
+// put back every robot exactly as it was saved
+// layouts has to be rebuilt from savedSharedSeeds() so shared layouts are shared again
+template <typename Grid, std::size_t GeneCount>
+void restorePopulation(const CheckpointFile& file, LayoutSource<Grid>& layouts, Population<Grid, GeneCount>& robots)
+{
+    const CheckpointHeader& header {file.header()};
+    const std::uint32_t* layoutSeeds {file.section<std::uint32_t>(header.layoutSeedsOffset)};
+    const Coordinates* coordinates {file.section<Coordinates>(header.coordinatesOffset)};
+    const std::int32_t* power {file.section<std::int32_t>(header.powerOffset)};
+    const std::int32_t* turnsSurvived {file.section<std::int32_t>(header.turnsSurvivedOffset)};
+    const std::int32_t* powerHarvested {file.section<std::int32_t>(header.powerHarvestedOffset)};
+    const double* fitness {file.section<double>(header.fitnessOffset)};
+    const std::int32_t* fitnessMin {file.section<std::int32_t>(header.fitnessMinOffset)};
+    const double* fitnessVariance {file.section<double>(header.fitnessVarianceOffset)};
+
+    robots = Population<Grid, GeneCount> {};
+    robots.reserve(header.robotCount);
+    for (std::size_t i {0}; i < header.robotCount; ++i)
+    {
+        std::size_t robot {robots.addRobot(layouts.layoutForSeed(layoutSeeds[i]), coordinates[i])};
+        robots.getGenome(robot) = savedGenome<GeneCount>(file, i);
+        robots.storeResult(robot, coordinates[i], power[i], turnsSurvived[i], powerHarvested[i]);
+        robots.storeFitness(robot, fitness[i], fitnessMin[i], fitnessVariance[i]);
+    }
+}
+
+// start a new population from the genomes of a saved one
+// every robot is spawned fresh on the new run's layouts, in the same order as they were saved
+template <typename Grid, std::size_t GeneCount>
+void seedPopulation(const CheckpointFile& file, LayoutSource<Grid>& layouts, Rng& rng, Population<Grid, GeneCount>& robots)
+{
+    robots = Population<Grid, GeneCount> {};
+    robots.reserve(file.header().robotCount);
+    for (std::size_t i {0}; i < file.header().robotCount; ++i)
+    {
+        std::size_t robot {robots.addRobot(layouts.nextLayout(rng), rng)};
+        robots.getGenome(robot) = savedGenome<GeneCount>(file, i);
+    }
+}
+
+#endif
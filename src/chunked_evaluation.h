@@ -0,0 +1,129 @@
+#ifndef CHUNKED_EVALUATION_H
+#define CHUNKED_EVALUATION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "counter_rng.h"
+#include "evaluation_arena.h"
+#include "genetic_algorithm.h"
+#include "genetic_engine.h"
+#include "genome.h"
+#include "map.h"
+#include "population.h"
+#include "rng.h"
+#include "selection.h"
+#include "thread_pool.h"
+
+// evaluation for populations too big to keep a whole Population of, for --chunk-size
+// only the packed genomes and their fitness stay in memory between generations, the
+// robots are put on a layout and simulated a chunk at a time in one small Population
+// that is emptied again before the next chunk, so a run of 10 million robots holds the
+// simulation state of a few thousand at once
+//
+// like in main() a robot is only simulated once, parents keep the score they were given
+// as children, and selection only reads the fitness array and breeding only writes
+// genomes, so both run on the genomes as they are and never need the simulation state
+
+// scores the robots of a GenomePopulation that have no score yet, chunk by chunk on the
+// thread pool
+// a robot's layout and spawn are looked up by generation and robot index like its life
+// seed is, so the scores are the same for any chunk size and any number of threads
+template <typename Grid, std::size_t GeneCount>
+class ChunkedEvaluator
+{
+    public:
+        using PopulationType = GenomePopulation<Genome<GeneCount>>;
+        using ArenaType = EvaluationArena<Grid, GeneCount>;
+    private:
+        ThreadPool& m_pool;
+        CounterRng m_lifeRng {};
+        std::vector<ArenaType>& m_arenas;
+        LayoutSource<Grid>& m_layouts;
+        std::size_t m_trials {1};
+        bool m_batched {false};
+        std::size_t m_chunkSize {1};
+        std::uint32_t m_generation {0};
+
+        // the robots being simulated, only ever as big as one chunk
+        Population<Grid, GeneCount> m_chunk {};
+        // chunks simulated so far
+        std::size_t m_chunkCount {};
+
+        // robots [begin, end) of robots, which have no score yet
+        void evaluateChunk(PopulationType& robots, std::size_t begin, std::size_t end)
+        {
+            // emptied first so the layouts of the last chunk can be used again
+            m_chunk.truncate(0);
+            m_chunk.reserve(end - begin);
+            for (std::size_t i {begin}; i < end; ++i)
+            {
+                Rng placement {m_lifeRng.at(RandomPurpose::RobotPlacement, m_generation, i)};
+                m_chunk.getGenome(m_chunk.addRobot(m_layouts.nextLayout(placement), placement)) = robots.getGenome(i);
+            }
+
+            evaluateRobots(m_chunk, m_pool, LifeSeeds {m_lifeRng, m_generation, begin}, m_arenas, m_layouts, m_trials, m_batched);
+
+            for (std::size_t i {begin}; i < end; ++i)
+            {
+                robots.storeFitness(i, m_chunk.getFitness(i - begin), m_chunk.getFitnessMin(i - begin), m_chunk.getFitnessVariance(i - begin));
+            }
+            ++m_chunkCount;
+        }
+    public:
+        ChunkedEvaluator(ThreadPool& pool, const CounterRng& lifeRng, std::vector<ArenaType>& arenas, LayoutSource<Grid>& layouts, std::size_t trials, bool batched, std::size_t chunkSize)
+        : m_pool {pool}
+        , m_lifeRng {lifeRng}
+        , m_arenas {arenas}
+        , m_layouts {layouts}
+        , m_trials {trials}
+        , m_batched {batched}
+        , m_chunkSize {std::max<std::size_t>(chunkSize, 1)}
+        {
+            m_chunk.returnLayoutsTo(m_layouts);
+        }
+
+        // the robots without a score come in runs, after breeding that is every child
+        // in one run behind the parents, and each run is cut into chunks
+        bool evaluate(PopulationType& robots)
+        {
+            std::size_t begin {0};
+            while (begin < robots.size())
+            {
+                if (robots.isScored(begin))
+                {
+                    ++begin;
+                    continue;
+                }
+
+                std::size_t end {begin + 1};
+                while (end < robots.size() && end - begin < m_chunkSize && !robots.isScored(end))
+                {
+                    ++end;
+                }
+                evaluateChunk(robots, begin, end);
+                begin = end;
+            }
+
+            m_chunk.truncate(0);
+            ++m_generation;
+            return true;
+        }
+
+        // a child is only a genome until its chunk is scored
+        std::size_t addChild(PopulationType& robots, Rng&)
+        {
+            return robots.addRobot();
+        }
+
+        std::size_t getChunkCount() const {return m_chunkCount;}
+        std::size_t getChunkSize() const {return m_chunkSize;}
+};
+
+template <typename Grid, std::size_t GeneCount>
+using ChunkedEngine = GeneticEngine<Genome<GeneCount>, ChunkedEvaluator<Grid, GeneCount>, Selector, HalfCrossover, PointMutation>;
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef COUNTER_RNG_H
+#define COUNTER_RNG_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// random numbers looked up by where they are used instead of drawn one after another
+// Philox4x32-10 turns a 128 bit counter and a 64 bit key into 128 random bits with no
+// state in between, so the number for (generation, robot, step) is the same no matter
+// which thread asks for it, in what order, or how many numbers were asked for before it
+//
+// the key is the run seed and what the number is for, the counter is the robot index,
+// the generation and the step, so every purpose is its own unrelated stream
+//
+// the robots of a range can be filled in one loop with nothing carried from one robot to
+// the next, which the compiler can turn into vector multiplies
+
+// what a number is used for, every purpose gets its own stream
+enum class RandomPurpose : std::uint32_t
+{
+    // the seed of a robot's life, its steps and extra trials are drawn from an Rng made from it
+    RobotLife = 1,
+    // the layout a robot is put on and where it spawns, for runs that place robots when
+    // they are scored instead of when they are born
+    RobotPlacement = 2,
+};
+
+class CounterRng
+{
+    private:
+        static constexpr std::uint32_t MULTIPLIER_0 {0xD2511F53u};
+        static constexpr std::uint32_t MULTIPLIER_1 {0xCD9E8D57u};
+        static constexpr std::uint32_t KEY_STEP_0 {0x9E3779B9u};
+        static constexpr std::uint32_t KEY_STEP_1 {0xBB67AE85u};
+
+        std::uint32_t m_seed {};
+    public:
+        using Block = std::array<std::uint32_t, 4>;
+
+        CounterRng() = default;
+
+        explicit CounterRng(std::uint32_t seed)
+        : m_seed {seed}
+        {
+        }
+
+        // the raw generator, 10 rounds of Philox4x32
+        static Block philox(Block counter, std::uint32_t key0, std::uint32_t key1)
+        {
+            for (int round {0}; round < 10; ++round)
+            {
+                std::uint64_t product0 {static_cast<std::uint64_t>(MULTIPLIER_0) * counter[0]};
+                std::uint64_t product1 {static_cast<std::uint64_t>(MULTIPLIER_1) * counter[2]};
+                counter = Block {static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^ key0, static_cast<std::uint32_t>(product1),
+                                 static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^ key1, static_cast<std::uint32_t>(product0)};
+                key0 += KEY_STEP_0;
+                key1 += KEY_STEP_1;
+            }
+            return counter;
+        }
+
+        // 4 random numbers for one robot, generation and step
+        Block block(RandomPurpose purpose, std::uint32_t generation, std::uint64_t robot, std::uint32_t step = 0) const
+        {
+            Block counter {static_cast<std::uint32_t>(robot), static_cast<std::uint32_t>(robot >> 32), generation, step};
+            return philox(counter, m_seed, static_cast<std::uint32_t>(purpose));
+        }
+
+        std::uint32_t at(RandomPurpose purpose, std::uint32_t generation, std::uint64_t robot, std::uint32_t step = 0) const
+        {
+            return block(purpose, generation, robot, step)[0];
+        }
+
+        // at() for robots [begin, end), written to out[0] to out[end - begin - 1]
+        void fill(RandomPurpose purpose, std::uint32_t generation, std::size_t begin, std::size_t end, std::uint32_t* out) const
+        {
+            for (std::size_t i {begin}; i < end; ++i)
+            {
+                out[i - begin] = at(purpose, generation, i);
+            }
+        }
+
+        std::uint32_t getSeed() const {return m_seed;}
+};
+
+// the seeds of one generation's robot lives, robot i gets the same seed whichever worker
+// thread or process scores it
+// a population that only holds part of the generation starts at firstRobot, so its
+// robot 0 gets the seed of robot firstRobot of the whole generation
+class LifeSeeds
+{
+    private:
+        CounterRng m_rng {};
+        std::uint32_t m_generation {};
+        std::uint64_t m_firstRobot {};
+    public:
+        LifeSeeds(const CounterRng& rng, std::uint32_t generation, std::uint64_t firstRobot = 0)
+        : m_rng {rng}
+        , m_generation {generation}
+        , m_firstRobot {firstRobot}
+        {
+        }
+
+        std::uint32_t at(std::size_t robot) const {return m_rng.at(RandomPurpose::RobotLife, m_generation, m_firstRobot + robot);}
+
+        void fill(std::size_t begin, std::size_t end, std::uint32_t* out) const
+        {
+            m_rng.fill(RandomPurpose::RobotLife, m_generation, static_cast<std::size_t>(m_firstRobot + begin), static_cast<std::size_t>(m_firstRobot + end), out);
+        }
+};
+
+#endif
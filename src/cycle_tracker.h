@@ -0,0 +1,93 @@
+#ifndef CYCLE_TRACKER_H
+#define CYCLE_TRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// remembers the cells a robot has stood on since its map or random state last changed
+// between a battery pickup and a random move, where a robot goes next only depends on
+// where it is, so standing on a cell a second time means it is stuck in a loop for good
+//
+// every cell is stamped with its place in the path plus a base that moves past all the
+// old stamps on reset(), so starting a new path never has to clear the grid
+template <typename Grid>
+class CycleTracker
+{
+    public:
+        static constexpr std::size_t NOT_SEEN {std::numeric_limits<std::size_t>::max()};
+    private:
+        typename Grid::template CellArray<std::uint32_t> m_seen {};
+        std::uint32_t m_base {0};
+        // cell indices in the order they were visited
+        std::vector<std::uint32_t> m_path {};
+
+        std::size_t cycleLength(std::size_t start) const {return m_path.size() - start;}
+
+        // the cell the robot moves to from m_path[i]
+        std::uint32_t nextCell(std::size_t start, std::size_t i) const {return i + 1 < m_path.size() ? m_path[i + 1] : m_path[start];}
+    public:
+        explicit CycleTracker(const Grid& grid = Grid {})
+        : m_seen {grid.template makeCellArray<std::uint32_t>()}
+        {
+            m_path.reserve(grid.cellCount());
+        }
+
+        // start a new path, the cells visited so far no longer count
+        void reset()
+        {
+            // a path never holds a cell twice, so it is never longer than the grid
+            if (m_base > std::numeric_limits<std::uint32_t>::max() - 2 * m_seen.size())
+            {
+                for (std::uint32_t& stamp : m_seen)
+                {
+                    stamp = 0;
+                }
+                m_base = 0;
+            }
+            else
+            {
+                m_base += static_cast<std::uint32_t>(m_path.size());
+            }
+            m_path.clear();
+        }
+
+        // add a cell to the path, or return where in the path the robot already stood on it
+        std::size_t visit(std::size_t cell)
+        {
+            std::uint32_t stamp {m_seen[cell]};
+            if (stamp > m_base)
+                return stamp - m_base - 1;
+
+            m_path.push_back(static_cast<std::uint32_t>(cell));
+            m_seen[cell] = m_base + static_cast<std::uint32_t>(m_path.size());
+            return NOT_SEEN;
+        }
+
+        // where the robot is after going round the loop that starts at m_path[start] for steps more steps
+        std::size_t cellAfter(std::size_t start, std::size_t steps) const
+        {
+            return m_path[start + steps % cycleLength(start)];
+        }
+
+        // how many of those steps walk into a wall, a step into a wall leaves the robot where it was
+        std::uint64_t wallBumpsAfter(std::size_t start, std::size_t steps) const
+        {
+            std::size_t length {cycleLength(start)};
+            std::uint64_t perLoop {0};
+            std::uint64_t partial {0};
+            for (std::size_t i {start}; i < m_path.size(); ++i)
+            {
+                if (nextCell(start, i) != m_path[i])
+                    continue;
+
+                ++perLoop;
+                if (i - start < steps % length)
+                    ++partial;
+            }
+            return perLoop * (steps / length) + partial;
+        }
+};
+
+#endif
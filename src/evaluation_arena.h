@@ -0,0 +1,276 @@
+#ifndef EVALUATION_ARENA_H
+#define EVALUATION_ARENA_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "batch_simulator.h"
+#include "counter_rng.h"
+#include "cycle_tracker.h"
+#include "evaluation_set.h"
+#include "map.h"
+#include "population.h"
+#include "rng.h"
+#include "robot.h"
+#include "stats.h"
+
+// the random state of one trial of a robot's life, every trial is its own stream of the
+// robot's life seed
+inline Rng trialRng(std::uint32_t robotSeed, std::size_t trial)
+{
+    if (trial == 0)
+        return Rng {robotSeed};
+    return Rng {robotSeed, Rng::DEFAULT_STREAM + trial};
+}
+
+// mean, min and variance of one robot's trials
+template <typename PopulationType>
+void storeTrialScores(PopulationType& robots, std::size_t i, const int* scores, std::size_t trials)
+{
+    int total {0};
+    int min {scores[0]};
+    for (std::size_t t {0}; t < trials; ++t)
+    {
+        total += scores[t];
+        if (scores[t] < min)
+            min = scores[t];
+    }
+
+    double mean {static_cast<double>(total) / static_cast<double>(trials)};
+    double variance {0.0};
+    for (std::size_t t {0}; t < trials; ++t)
+    {
+        double difference {scores[t] - mean};
+        variance += difference * difference;
+    }
+
+    robots.storeFitness(i, mean, min, variance / static_cast<double>(trials));
+}
+
+// scratch space owned by one worker thread and reused for every robot it evaluates
+// a robot is run for a number of trials: trial 0 is its own layout from where it spawned,
+// the other trials are extra layouts built in place in the arena, so running N trials
+// never constructs or copies N maps
+//
+// every robot gets one seed for its life and every trial gets its own stream of that
+// seed, so the scalar and batched paths give the same scores
+// main() looks the seeds up by generation and robot index in LifeSeeds, so a robot's
+// score does not depend on which worker runs it, callers that run every robot on one
+// thread anyway can draw the seeds from a single Rng instead
+//
+// given a fixed EvaluationSet, every robot is scored on the set's trials instead and
+// nothing is drawn from the worker's random state
+template <typename Grid, std::size_t GeneCount>
+class EvaluationArena
+{
+    public:
+        using PopulationType = Population<Grid, GeneCount>;
+        using Batch = BatchSimulator<Grid>;
+    private:
+        BatteryLayout<Grid> m_trialLayout {};
+        CycleTracker<Grid> m_cycles {};
+        Batch m_batch {};
+        // scores of the robots being evaluated, trials in a row for each robot
+        std::vector<int> m_scores {};
+        std::vector<std::size_t> m_evaluatedRobots {};
+        // the life seed of each robot in the range being evaluated
+        std::vector<std::uint32_t> m_lifeSeeds {};
+
+        // what a lane in the batch is working on
+        std::array<std::size_t, Batch::LANES> m_laneRobots {};
+        std::array<std::size_t, Batch::LANES> m_laneTrials {};
+        std::size_t m_lanesUsed {};
+
+        // events counted by this arena's thread, only filled in with GA_ENABLE_STATS
+        SimulationCounters m_counters {};
+
+        // seeds for robots [begin, end), drawn from rng in order for every robot that needs one
+        const std::uint32_t* drawLifeSeeds(const PopulationType& robots, std::size_t begin, std::size_t end, Rng& rng, const EvaluationSet<Grid>* fixedSet)
+        {
+            m_lifeSeeds.resize(end - begin);
+            for (std::size_t i {begin}; i < end; ++i)
+            {
+                m_lifeSeeds[i - begin] = fixedSet || robots.getPower(i) == 0 ? 0 : rng.nextSeed();
+            }
+            return m_lifeSeeds.data();
+        }
+
+        const std::uint32_t* lookUpLifeSeeds(std::size_t begin, std::size_t end, const LifeSeeds& seeds, const EvaluationSet<Grid>* fixedSet)
+        {
+            m_lifeSeeds.resize(end - begin);
+            if (!fixedSet)
+                seeds.fill(begin, end, m_lifeSeeds.data());
+            return m_lifeSeeds.data();
+        }
+
+        void runBatch(PopulationType& robots, std::size_t begin, std::size_t trials)
+        {
+            m_batch.run();
+            GA_COUNT(lives, m_lanesUsed);
+            for (std::size_t lane {0}; lane < m_lanesUsed; ++lane)
+            {
+                std::size_t i {m_laneRobots[lane]};
+                m_scores[(i - begin) * trials + m_laneTrials[lane]] = m_batch.getPowerHarvested(lane);
+
+                // the population keeps how the robot did on its own layout
+                if (m_laneTrials[lane] == 0)
+                    robots.storeResult(i, m_batch.getCoordinates(lane), m_batch.getPower(lane), m_batch.getTurnsSurvived(lane), m_batch.getPowerHarvested(lane));
+            }
+            m_lanesUsed = 0;
+            m_batch.clear();
+        }
+    public:
+        explicit EvaluationArena(const Grid& grid = Grid {})
+        : m_trialLayout {grid}
+        , m_cycles {grid}
+        , m_batch {grid}
+        {
+        }
+
+        // simulates robots [begin, end) one after another
+        void evaluateRange(PopulationType& robots, std::size_t begin, std::size_t end, const LayoutSource<Grid>& layouts, std::size_t trials, const LifeSeeds& seeds,
+                           const EvaluationSet<Grid>* fixedSet = nullptr)
+        {
+            evaluateRange(robots, begin, end, layouts, trials, lookUpLifeSeeds(begin, end, seeds, fixedSet), fixedSet);
+        }
+
+        void evaluateRange(PopulationType& robots, std::size_t begin, std::size_t end, const LayoutSource<Grid>& layouts, std::size_t trials, Rng& rng,
+                           const EvaluationSet<Grid>* fixedSet = nullptr)
+        {
+            evaluateRange(robots, begin, end, layouts, trials, drawLifeSeeds(robots, begin, end, rng, fixedSet), fixedSet);
+        }
+
+        // lifeSeeds[i - begin] is the seed of robot i, not used with a fixed set
+        void evaluateRange(PopulationType& robots, std::size_t begin, std::size_t end, const LayoutSource<Grid>& layouts, std::size_t trials, const std::uint32_t* lifeSeeds,
+                           const EvaluationSet<Grid>* fixedSet = nullptr)
+        {
+            if (fixedSet)
+                trials = fixedSet->size();
+            m_scores.resize(trials);
+
+            for (std::size_t i {begin}; i < end; ++i)
+            {
+                // robots that survived the last generation already ran out of power
+                // and keep the score they had
+                if (robots.getPower(i) == 0)
+                    continue;
+
+                std::uint32_t robotSeed {fixedSet ? 0 : lifeSeeds[i - begin]};
+                robots.storeLifeSeed(i, robotSeed);
+                typename PopulationType::RobotType robot {robots.getRobot(i)};
+
+                for (std::size_t t {0}; t < trials; ++t)
+                {
+                    Rng robotRng {fixedSet ? fixedSet->getRng(t) : trialRng(robotSeed, t)};
+
+                    if (fixedSet)
+                    {
+                        robot.respawn(fixedSet->getLayout(t), fixedSet->getSpawn(t));
+                    }
+                    else if (t > 0)
+                    {
+                        const BatteryLayout<Grid>& layout {layouts.trialLayout(m_trialLayout, robotRng)};
+                        robot.respawn(layout, layout.spawnRobot(robotRng));
+                    }
+
+                    // keep moving until the robot runs out of power
+                    robot.runLife(robotRng, m_cycles);
+
+                    m_scores[t] = robot.getPowerHarvested();
+                    GA_COUNT(lives, 1);
+
+                    // the population keeps how the robot did on its own layout
+                    if (t == 0)
+                        robots.storeRobot(i, robot);
+                }
+
+                storeTrialScores(robots, i, m_scores.data(), trials);
+            }
+            takeThreadCounters(m_counters);
+        }
+
+        // simulates robots [begin, end) in batches of Batch::LANES
+        // every trial of every robot is its own lane
+        void evaluateRangeBatched(PopulationType& robots, std::size_t begin, std::size_t end, const LayoutSource<Grid>& layouts, std::size_t trials, const LifeSeeds& seeds,
+                                  const EvaluationSet<Grid>* fixedSet = nullptr)
+        {
+            evaluateRangeBatched(robots, begin, end, layouts, trials, lookUpLifeSeeds(begin, end, seeds, fixedSet), fixedSet);
+        }
+
+        void evaluateRangeBatched(PopulationType& robots, std::size_t begin, std::size_t end, const LayoutSource<Grid>& layouts, std::size_t trials, Rng& rng,
+                                  const EvaluationSet<Grid>* fixedSet = nullptr)
+        {
+            evaluateRangeBatched(robots, begin, end, layouts, trials, drawLifeSeeds(robots, begin, end, rng, fixedSet), fixedSet);
+        }
+
+        void evaluateRangeBatched(PopulationType& robots, std::size_t begin, std::size_t end, const LayoutSource<Grid>& layouts, std::size_t trials, const std::uint32_t* lifeSeeds,
+                                  const EvaluationSet<Grid>* fixedSet = nullptr)
+        {
+            if (fixedSet)
+                trials = fixedSet->size();
+            m_scores.resize((end - begin) * trials);
+            m_evaluatedRobots.clear();
+            m_lanesUsed = 0;
+            m_batch.clear();
+
+            for (std::size_t i {begin}; i < end; ++i)
+            {
+                if (robots.getPower(i) == 0)
+                    continue;
+
+                std::uint32_t robotSeed {fixedSet ? 0 : lifeSeeds[i - begin]};
+                robots.storeLifeSeed(i, robotSeed);
+                std::array<std::uint8_t, SENSOR_STATES> actionTable {robots.getGenome(i).compileActionTable()};
+                m_evaluatedRobots.push_back(i);
+
+                for (std::size_t t {0}; t < trials; ++t)
+                {
+                    Rng robotRng {fixedSet ? fixedSet->getRng(t) : trialRng(robotSeed, t)};
+
+                    if (fixedSet)
+                    {
+                        m_batch.loadLane(m_lanesUsed, actionTable, fixedSet->getLayout(t), fixedSet->getSpawn(t), robotRng);
+                    }
+                    else if (t == 0)
+                    {
+                        m_batch.loadLane(m_lanesUsed, actionTable, robots.getLayout(i), robots.getCoordinates(i), robotRng);
+                    }
+                    else
+                    {
+                        // the lane copies the layout, so the scratch layout is free again right away
+                        const BatteryLayout<Grid>& layout {layouts.trialLayout(m_trialLayout, robotRng)};
+                        Coordinates spawn {layout.spawnRobot(robotRng)};
+                        m_batch.loadLane(m_lanesUsed, actionTable, layout, spawn, robotRng);
+                    }
+
+                    m_laneRobots[m_lanesUsed] = i;
+                    m_laneTrials[m_lanesUsed] = t;
+                    ++m_lanesUsed;
+
+                    if (m_lanesUsed == Batch::LANES)
+                        runBatch(robots, begin, trials);
+                }
+            }
+
+            // the last batch may not fill every lane
+            if (m_lanesUsed > 0)
+                runBatch(robots, begin, trials);
+
+            for (std::size_t i : m_evaluatedRobots)
+            {
+                storeTrialScores(robots, i, &m_scores[(i - begin) * trials], trials);
+            }
+            takeThreadCounters(m_counters);
+        }
+
+        // add what this arena counted to total and start again from zero
+        void takeCounters(SimulationCounters& total)
+        {
+            total += m_counters;
+            m_counters = SimulationCounters {};
+        }
+};
+
+#endif
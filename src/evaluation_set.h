@@ -0,0 +1,48 @@
+#ifndef EVALUATION_SET_H
+#define EVALUATION_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "map.h"
+#include "rng.h"
+
+// a fixed set of trials that every robot is scored on: the same layouts, the same
+// spawn spots and the same random streams for random moves
+// with a fixed set a robot's fitness only depends on its genome and the set's seed,
+// which is what lets scores be cached and reused for identical genomes
+template <typename Grid>
+class EvaluationSet
+{
+    private:
+        std::uint32_t m_seed {};
+        std::vector<BatteryLayout<Grid>> m_layouts {};
+        std::vector<Coordinates> m_spawns {};
+        std::vector<Rng> m_rngs {};
+    public:
+        // trial t is built from stream t of the seed
+        EvaluationSet(const Grid& grid, std::uint32_t seed, std::size_t trials)
+        : m_seed {seed}
+        {
+            m_layouts.reserve(trials);
+            for (std::size_t t {0}; t < trials; ++t)
+            {
+                Rng rng {seed, Rng::DEFAULT_STREAM + t};
+                m_layouts.emplace_back(grid, rng.nextSeed());
+                m_spawns.push_back(m_layouts.back().spawnRobot(rng));
+                m_rngs.push_back(rng);
+            }
+        }
+
+        std::uint32_t getSeed() const {return m_seed;}
+        std::size_t size() const {return m_layouts.size();}
+
+        const BatteryLayout<Grid>& getLayout(std::size_t trial) const {return m_layouts[trial];}
+        Coordinates getSpawn(std::size_t trial) const {return m_spawns[trial];}
+
+        // every robot starts the trial with a copy of the same stream
+        const Rng& getRng(std::size_t trial) const {return m_rngs[trial];}
+};
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef FITNESS_CACHE_H
+#define FITNESS_CACHE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "genome.h"
+#include "map.h"
+
+// everything an evaluation writes back to the population for one robot
+struct CachedFitness
+{
+    double mean {};
+    int min {};
+    double variance {};
+    // how trial 0 ended
+    Coordinates coordinates {};
+    int power {};
+    int turnsSurvived {};
+    int powerHarvested {};
+    // the seed trial 0 ran with, see Population::storeLifeSeed()
+    std::uint32_t lifeSeed {};
+};
+
+// scores of genomes that have already been simulated on a fixed evaluation set
+// keyed by the packed genome and the set's seed, so a score is never reused for a
+// different set of maps
+//
+// the size is bounded, when it is full the CLOCK hand walks the slots clearing the
+// referenced bit of each entry and evicts the first one that was not used since the
+// hand last went past it
+template <std::size_t GeneCount>
+class FitnessCache
+{
+    public:
+        struct Key
+        {
+            std::array<std::uint64_t, Genome<GeneCount>::WORD_COUNT> words {};
+            std::uint32_t evaluationSeed {};
+
+            friend bool operator==(const Key& a, const Key& b) {return a.words == b.words && a.evaluationSeed == b.evaluationSeed;}
+        };
+
+        // mixes every word with the splitmix64 finalizer
+        struct KeyHash
+        {
+            std::size_t operator()(const Key& key) const
+            {
+                std::uint64_t hash {key.evaluationSeed};
+                for (std::uint64_t word : key.words)
+                {
+                    hash ^= word + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+                    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+                    hash ^= hash >> 31;
+                }
+                return static_cast<std::size_t>(hash);
+            }
+        };
+    private:
+        struct Slot
+        {
+            Key key {};
+            CachedFitness value {};
+            bool referenced {false};
+        };
+
+        using Index = std::unordered_map<Key, std::size_t, KeyHash>;
+
+        std::size_t m_capacity {};
+        std::vector<Slot> m_slots {};
+        Index m_index {};
+        std::size_t m_hand {};
+
+        std::uint64_t m_hits {};
+        std::uint64_t m_misses {};
+        std::uint64_t m_duplicates {};
+        std::uint64_t m_evictions {};
+
+        // the slot a new entry goes in, evicting one if every slot is taken
+        std::size_t freeSlot()
+        {
+            if (m_slots.size() < m_capacity)
+            {
+                m_slots.emplace_back();
+                return m_slots.size() - 1;
+            }
+
+            while (m_slots[m_hand].referenced)
+            {
+                m_slots[m_hand].referenced = false;
+                m_hand = (m_hand + 1) % m_slots.size();
+            }
+
+            std::size_t slot {m_hand};
+            m_hand = (m_hand + 1) % m_slots.size();
+            m_index.erase(m_slots[slot].key);
+            ++m_evictions;
+            return slot;
+        }
+    public:
+        explicit FitnessCache(std::size_t capacity)
+        : m_capacity {capacity > 0 ? capacity : 1}
+        {
+            m_slots.reserve(m_capacity);
+            m_index.reserve(m_capacity);
+        }
+
+        static Key keyOf(const Genome<GeneCount>& genome, std::uint32_t evaluationSeed)
+        {
+            return Key {genome.getWords(), evaluationSeed};
+        }
+
+        // null on a miss
+        const CachedFitness* find(const Key& key)
+        {
+            typename Index::const_iterator found {m_index.find(key)};
+            if (found == m_index.end())
+            {
+                ++m_misses;
+                return nullptr;
+            }
+
+            ++m_hits;
+            Slot& slot {m_slots[found->second]};
+            slot.referenced = true;
+            return &slot.value;
+        }
+
+        void insert(const Key& key, const CachedFitness& value)
+        {
+            typename Index::const_iterator found {m_index.find(key)};
+            if (found != m_index.end())
+            {
+                m_slots[found->second].value = value;
+                return;
+            }
+
+            std::size_t slot {freeSlot()};
+            m_slots[slot].key = key;
+            m_slots[slot].value = value;
+            m_slots[slot].referenced = false;
+            m_index.emplace(key, slot);
+        }
+
+        // a miss that was copied from an identical genome simulated in the same generation
+        void recordDuplicate()
+        {
+            --m_misses;
+            ++m_duplicates;
+        }
+
+        // getter functions
+        std::size_t size() const {return m_index.size();}
+        std::size_t capacity() const {return m_capacity;}
+        std::uint64_t getHits() const {return m_hits;}
+        std::uint64_t getMisses() const {return m_misses;}
+        std::uint64_t getDuplicates() const {return m_duplicates;}
+        std::uint64_t getEvictions() const {return m_evictions;}
+};
+
+#endif
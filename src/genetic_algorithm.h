@@ -0,0 +1,280 @@
+#ifndef GENETIC_ALGORITHM_H
+#define GENETIC_ALGORITHM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "counter_rng.h"
+#include "evaluation_arena.h"
+#include "evaluation_set.h"
+#include "fitness_cache.h"
+#include "genetic_engine.h"
+#include "genome.h"
+#include "map.h"
+#include "population.h"
+#include "process_evaluator.h"
+#include "rng.h"
+#include "selection.h"
+#include "thread_pool.h"
+
+// the steps of one generation: evaluate, sort, cull and breed
+// main() runs them through GeneticEngine with the robot policies at the bottom of this
+// file, the islands and the benchmarks call them one at a time
+
+// runs every robot until its power reaches 0 and stores its fitness in the population
+// each worker only touches its own range of robots and its own arena, and every robot's
+// life seed is looked up by its index, so the scores are the same for any thread count
+template <typename Grid, std::size_t GeneCount>
+void evaluateRobots(Population<Grid, GeneCount>& robots, ThreadPool& pool, const LifeSeeds& seeds, std::vector<EvaluationArena<Grid, GeneCount>>& arenas, const LayoutSource<Grid>& layouts, std::size_t trials, bool batched,
+                    const EvaluationSet<Grid>* fixedSet = nullptr)
+{
+    pool.parallelFor(robots.size(), [&](std::size_t begin, std::size_t end, std::size_t worker)
+    {
+        if (batched)
+            arenas[worker].evaluateRangeBatched(robots, begin, end, layouts, trials, seeds, fixedSet);
+        else
+            arenas[worker].evaluateRange(robots, begin, end, layouts, trials, seeds, fixedSet);
+    });
+}
+
+// evaluateRobots() on a fixed evaluation set, skipping every genome the cache already has
+// a score for and simulating each new genome only once even if many robots carry it
+//
+// robots that are not simulated are given their cached result, which leaves them out of
+// power like any other scored robot so the arenas skip them
+template <typename Grid, std::size_t GeneCount>
+void evaluateRobotsCached(Population<Grid, GeneCount>& robots, FitnessCache<GeneCount>& cache, ThreadPool& pool, const LifeSeeds& seeds, std::vector<EvaluationArena<Grid, GeneCount>>& arenas,
+                          const LayoutSource<Grid>& layouts, const EvaluationSet<Grid>& fixedSet, bool batched)
+{
+    using Key = typename FitnessCache<GeneCount>::Key;
+    using GenomeIndex = std::unordered_map<Key, std::size_t, typename FitnessCache<GeneCount>::KeyHash>;
+
+    auto applyResult = [&robots](std::size_t i, const CachedFitness& result)
+    {
+        robots.storeResult(i, result.coordinates, result.power, result.turnsSurvived, result.powerHarvested);
+        robots.storeFitness(i, result.mean, result.min, result.variance);
+    };
+
+    // the first robot with each new genome is simulated, the rest copy it afterwards
+    GenomeIndex firstWithGenome {};
+    std::vector<std::pair<std::size_t, std::size_t>> duplicates {};
+    std::vector<std::size_t> simulated {};
+
+    for (std::size_t i {0}; i < robots.size(); ++i)
+    {
+        if (robots.getPower(i) == 0)
+            continue;
+
+        Key key {FitnessCache<GeneCount>::keyOf(robots.getGenome(i), fixedSet.getSeed())};
+        if (const CachedFitness* cached {cache.find(key)})
+        {
+            applyResult(i, *cached);
+            continue;
+        }
+
+        typename GenomeIndex::const_iterator first {firstWithGenome.find(key)};
+        if (first != firstWithGenome.end())
+        {
+            cache.recordDuplicate();
+            duplicates.emplace_back(i, first->second);
+            // out of power for now so it is skipped, the real result is copied in below
+            robots.storeResult(i, robots.getCoordinates(i), 0, 0, 0);
+            continue;
+        }
+        firstWithGenome.emplace(key, i);
+        simulated.push_back(i);
+    }
+
+    evaluateRobots(robots, pool, seeds, arenas, layouts, fixedSet.size(), batched, &fixedSet);
+
+    for (std::size_t i : simulated)
+    {
+        CachedFitness result {robots.getFitness(i), robots.getFitnessMin(i), robots.getFitnessVariance(i),
+                              robots.getCoordinates(i), robots.getPower(i), robots.getTurnsSurvived(i), robots.getPowerHarvested(i)};
+        cache.insert(FitnessCache<GeneCount>::keyOf(robots.getGenome(i), fixedSet.getSeed()), result);
+    }
+
+    for (const std::pair<std::size_t, std::size_t>& duplicate : duplicates)
+    {
+        std::size_t original {duplicate.second};
+        applyResult(duplicate.first, CachedFitness {robots.getFitness(original), robots.getFitnessMin(original), robots.getFitnessVariance(original),
+                                                    robots.getCoordinates(original), robots.getPower(original), robots.getTurnsSurvived(original), robots.getPowerHarvested(original)});
+    }
+}
+
+// sorts the robot's fitness from greatest to least
+template <typename Grid, std::size_t GeneCount>
+void sortVector(Population<Grid, GeneCount>& robots) 
+{
+    robots.sortByFitness();
+}
+
+// deletes the robots that are in the bottom 50 percent in power harvested.
+template <typename Grid, std::size_t GeneCount>
+void destroyBottom50Percent(Population<Grid, GeneCount>& robots) 
+{
+    // compute the index to erase from
+    std::size_t size {robots.size() / 2};  // Floor result by default
+
+    // destroy robots from the halfway point to the end
+    robots.truncate(size);
+}
+
+// children are written straight into the slots the culled robots left behind, the
+// population keeps its storage between generations so nothing is allocated here
+template <typename Grid, std::size_t GeneCount>
+void breedRobots(Population<Grid, GeneCount>& robots, LayoutSource<Grid>& layouts, Rng& rng, int mutationPercent = DEFAULT_MUTATION_PERCENT)
+{
+    std::size_t parentCount {robots.size()};
+    robots.reserve(parentCount * 2);
+
+    // Iterate through the robots in pairs
+    // children are added after all of the parents
+    for (std::size_t i = 0; i + 1 < parentCount; i += 2)
+    {
+        // Create child robots with combined genes
+        std::size_t childRobot1 {robots.addRobot(layouts.nextLayout(rng), rng)};
+        robots.getGenome(childRobot1).setChildGenes(robots.getGenome(i).getGenesTopHalf(), robots.getGenome(i + 1).getGenesTopHalf(), rng, mutationPercent);
+
+        std::size_t childRobot2 {robots.addRobot(layouts.nextLayout(rng), rng)};
+        robots.getGenome(childRobot2).setChildGenes(robots.getGenome(i).getGenesBottomHalf(), robots.getGenome(i + 1).getGenesBottomHalf(), rng, mutationPercent);
+    }
+}
+
+// the battery robots as GeneticEngine policies
+
+// scores robots the way main() asked for: worker threads, worker processes or the
+// fitness cache, and places children on layouts from the layout source
+template <typename Grid, std::size_t GeneCount>
+class RobotEvaluator
+{
+    public:
+        using PopulationType = Population<Grid, GeneCount>;
+        using ArenaType = EvaluationArena<Grid, GeneCount>;
+    private:
+        ThreadPool& m_pool;
+        CounterRng m_lifeRng {};
+        std::vector<ArenaType>& m_arenas;
+        LayoutSource<Grid>& m_layouts;
+        std::size_t m_trials {1};
+        bool m_batched {false};
+        // the generation the next evaluate() scores, the life seeds are looked up by it
+        std::uint32_t m_generation {0};
+
+        // optional, null when not used
+        const EvaluationSet<Grid>* m_fixedSet {nullptr};
+        FitnessCache<GeneCount>* m_cache {nullptr};
+        ProcessEvaluator<Grid, GeneCount>* m_processes {nullptr};
+    public:
+        RobotEvaluator(ThreadPool& pool, const CounterRng& lifeRng, std::vector<ArenaType>& arenas, LayoutSource<Grid>& layouts, std::size_t trials, bool batched)
+        : m_pool {pool}
+        , m_lifeRng {lifeRng}
+        , m_arenas {arenas}
+        , m_layouts {layouts}
+        , m_trials {trials}
+        , m_batched {batched}
+        {
+        }
+
+        // the cache needs the fixed set
+        void useFixedSet(const EvaluationSet<Grid>* fixedSet) {m_fixedSet = fixedSet;}
+        void useCache(FitnessCache<GeneCount>* cache) {m_cache = cache;}
+        void useProcesses(ProcessEvaluator<Grid, GeneCount>* processes) {m_processes = processes;}
+
+        // a resumed run carries on from the generation it was saved at
+        void startAtGeneration(std::uint32_t generation) {m_generation = generation;}
+
+        bool evaluate(PopulationType& robots)
+        {
+            LifeSeeds seeds {m_lifeRng, m_generation++};
+            if (m_processes)
+                return m_processes->evaluate(robots, seeds);
+
+            if (m_cache)
+                evaluateRobotsCached(robots, *m_cache, m_pool, seeds, m_arenas, m_layouts, *m_fixedSet, m_batched);
+            else
+                evaluateRobots(robots, m_pool, seeds, m_arenas, m_layouts, m_trials, m_batched, m_fixedSet);
+            return true;
+        }
+
+        std::size_t addChild(PopulationType& robots, Rng& rng)
+        {
+            return robots.addRobot(m_layouts.nextLayout(rng), rng);
+        }
+};
+
+// scores robots on the calling thread with a single arena, for runs that already have a
+// thread of their own like the jobs of a sweep
+// the life seeds are looked up the same way RobotEvaluator looks them up, so a run gives
+// the same robots here as it does in main() with any number of threads
+template <typename Grid, std::size_t GeneCount>
+class ArenaEvaluator
+{
+    public:
+        using PopulationType = Population<Grid, GeneCount>;
+    private:
+        EvaluationArena<Grid, GeneCount> m_arena;
+        CounterRng m_lifeRng {};
+        std::uint32_t m_generation {0};
+        LayoutSource<Grid>& m_layouts;
+        std::size_t m_trials {1};
+        bool m_batched {false};
+    public:
+        ArenaEvaluator(const Grid& grid, const CounterRng& lifeRng, LayoutSource<Grid>& layouts, std::size_t trials, bool batched)
+        : m_arena {grid}
+        , m_lifeRng {lifeRng}
+        , m_layouts {layouts}
+        , m_trials {trials}
+        , m_batched {batched}
+        {
+        }
+
+        bool evaluate(PopulationType& robots)
+        {
+            LifeSeeds seeds {m_lifeRng, m_generation++};
+            if (m_batched)
+                m_arena.evaluateRangeBatched(robots, 0, robots.size(), m_layouts, m_trials, seeds);
+            else
+                m_arena.evaluateRange(robots, 0, robots.size(), m_layouts, m_trials, seeds);
+            return true;
+        }
+
+        std::size_t addChild(PopulationType& robots, Rng& rng)
+        {
+            return robots.addRobot(m_layouts.nextLayout(rng), rng);
+        }
+};
+
+// the first child gets the top halves of both parents, the second the bottom halves
+struct HalfCrossover
+{
+    template <std::size_t GeneCount>
+    void operator()(const Genome<GeneCount>& a, const Genome<GeneCount>& b, std::size_t child, Genome<GeneCount>& out) const
+    {
+        if (child == 0)
+            out.setGenes(a.getGenesTopHalf(), b.getGenesTopHalf());
+        else
+            out.setGenes(a.getGenesBottomHalf(), b.getGenesBottomHalf());
+    }
+};
+
+// a 5% chance of changing one sensor state unless another percent is given
+struct PointMutation
+{
+    int percent {DEFAULT_MUTATION_PERCENT};
+
+    template <std::size_t GeneCount>
+    void operator()(Genome<GeneCount>& genome, Rng& rng) const
+    {
+        genome.mutate(rng, percent);
+    }
+};
+
+template <typename Grid, std::size_t GeneCount>
+using RobotEngine = GeneticEngine<Genome<GeneCount>, RobotEvaluator<Grid, GeneCount>, Selector, HalfCrossover, PointMutation>;
+
+#endif
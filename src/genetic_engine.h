@@ -0,0 +1,104 @@
+#ifndef GENETIC_ENGINE_H
+#define GENETIC_ENGINE_H
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "rng.h"
+
+// one generation of a genetic algorithm, put together from policies at compile time
+// every policy is a plain class the engine holds by value and calls directly, so the
+// compiler sees through all of it and nothing in a generation goes through a virtual call
+//
+// the policies it needs:
+//
+//  Evaluator   using PopulationType = ...;
+//              bool evaluate(PopulationType&)                   scores every robot that needs it, false if it could not
+//              std::size_t addChild(PopulationType&, Rng&)      adds a robot to the environment and returns its index,
+//                                                               its genome is overwritten right after
+//  Selector    const std::vector<std::size_t>& select(const std::vector<double>& fitness, std::size_t size, std::size_t count, Rng&)
+//                                                               the parents, in breeding order
+//  Crossover   void operator()(const Genome& a, const Genome& b, std::size_t child, Genome& out)
+//                                                               writes child 0 or 1 of parents a and b
+//  Mutator     void operator()(Genome&, Rng&)
+//
+// and the population:
+//
+//  size(), reserve(std::size_t), getGenome(std::size_t) returning Genome&,
+//  getFitness() returning the fitness array, reorder(const std::vector<std::size_t>&)
+template <typename Genome, typename Evaluator, typename Selector, typename Crossover, typename Mutator>
+class GeneticEngine
+{
+    public:
+        using PopulationType = typename Evaluator::PopulationType;
+
+        static_assert(std::is_same<decltype(std::declval<PopulationType&>().getGenome(std::size_t {})), Genome&>::value,
+                      "the evaluator's population has to hold this genome");
+    private:
+        Evaluator m_evaluator;
+        Selector m_selector;
+        Crossover m_crossover;
+        Mutator m_mutator;
+    public:
+        explicit GeneticEngine(Evaluator evaluator, Selector selector = Selector {}, Crossover crossover = Crossover {}, Mutator mutator = Mutator {})
+        : m_evaluator {std::move(evaluator)}
+        , m_selector {std::move(selector)}
+        , m_crossover {std::move(crossover)}
+        , m_mutator {std::move(mutator)}
+        {
+        }
+
+        bool evaluate(PopulationType& population)
+        {
+            return m_evaluator.evaluate(population);
+        }
+
+        // half of the population, the parents of the next generation in breeding order
+        const std::vector<std::size_t>& pickParents(const PopulationType& population, Rng& rng)
+        {
+            return m_selector.select(population.getFitness(), population.size(), population.size() / 2, rng);
+        }
+
+        // keep only the parents, at the front in breeding order
+        void select(PopulationType& population, Rng& rng)
+        {
+            population.reorder(pickParents(population, rng));
+        }
+
+        // every pair of neighbouring parents has two children, added after all of the parents
+        void breed(PopulationType& population, Rng& rng)
+        {
+            std::size_t parentCount {population.size()};
+            // no parent moves while its children are written
+            population.reserve(parentCount * 2);
+
+            for (std::size_t i {0}; i + 1 < parentCount; i += 2)
+            {
+                for (std::size_t child {0}; child < 2; ++child)
+                {
+                    std::size_t index {m_evaluator.addChild(population, rng)};
+                    Genome& genome {population.getGenome(index)};
+                    m_crossover(population.getGenome(i), population.getGenome(i + 1), child, genome);
+                    m_mutator(genome, rng);
+                }
+            }
+        }
+
+        // a whole generation, for callers that don't need to look in between the steps
+        bool step(PopulationType& population, Rng& rng)
+        {
+            if (!evaluate(population))
+                return false;
+
+            select(population, rng);
+            breed(population, rng);
+            return true;
+        }
+
+        Evaluator& getEvaluator() {return m_evaluator;}
+        Selector& getSelector() {return m_selector;}
+};
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef GENOME_H
+#define GENOME_H
+
+#include <iostream>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "map.h"
+#include "rng.h"
+
+// each gene has four sensor states for each direction
+// also has the action code that tells the robot what to do in the
+// event the current sensor state matches the four states on the gene
+//
+// a gene is packed into 16 bits:
+// bits 0-1 north, bits 2-3 south, bits 4-5 east, bits 6-7 west, bits 8-10 action code
+// so 4 genes fit in one 64 bit word and 16 genes fit in 4 words
+constexpr std::size_t GENE_BITS {16};
+constexpr std::size_t SENSOR_BITS {2};
+constexpr std::size_t ACTION_BITS {3};
+constexpr std::size_t ACTION_SLOT {4};
+
+// whether a packed gene only holds codes a robot can read and actions it can take,
+// a sensor state of 3 or an action above 4 would index past the 81 entry action table
+constexpr bool isValidGene(std::uint64_t gene)
+{
+    for (std::size_t slot {0}; slot < ACTION_SLOT; ++slot)
+    {
+        if (((gene >> (slot * SENSOR_BITS)) & ((std::uint64_t {1} << SENSOR_BITS) - 1)) > static_cast<std::uint64_t>(BATTERY))
+            return false;
+    }
+    return ((gene >> (ACTION_SLOT * SENSOR_BITS)) & ((std::uint64_t {1} << ACTION_BITS) - 1)) <= static_cast<std::uint64_t>(RandomDir);
+}
+
+// the chance in percent that a child has one of its sensor states changed
+constexpr int DEFAULT_MUTATION_PERCENT {5};
+
+template <std::size_t GeneCount>
+class Genome
+{
+    // crossover swaps whole words, so each half of the genes has to fill whole words
+    static_assert(GeneCount > 0 && GeneCount % 8 == 0, "the gene count has to be a multiple of 8");
+
+    public:
+        static constexpr std::size_t GENE_COUNT {GeneCount};
+        static constexpr std::size_t GENES_PER_WORD {64 / GENE_BITS};
+        static constexpr std::size_t WORD_COUNT {GENE_COUNT / GENES_PER_WORD};
+
+        // half of the genes, used for crossover
+        using Half = std::array<std::uint64_t, WORD_COUNT / 2>;
+    private:
+        std::array<std::uint64_t, WORD_COUNT> m_words {};
+
+        // where a sensor state or the action code of a gene starts in its word
+        static constexpr std::size_t shiftOf(std::size_t gene, std::size_t slot)
+        {
+            return (gene % GENES_PER_WORD) * GENE_BITS + slot * SENSOR_BITS;
+        }
+
+        static constexpr std::uint64_t maskOf(std::size_t slot)
+        {
+            return slot == ACTION_SLOT ? (std::uint64_t {1} << ACTION_BITS) - 1 : (std::uint64_t {1} << SENSOR_BITS) - 1;
+        }
+    public:
+        // fill the genes with random codes
+        // 0 = empty, 1 = wall, 2 = battery
+        // for the action code: 0 = north, 1 = south, 2 = east, 3 = west, 4 = random direction
+        static Genome random(Rng& rng)
+        {
+            Genome genome {};
+
+            for (std::size_t i {0}; i < GENE_COUNT; ++i)
+            {
+                for (std::size_t j {0}; j < ACTION_SLOT; ++j)
+                {
+                    genome.setState(i, j, rng.nextInt(3));
+                }
+                genome.setState(i, ACTION_SLOT, rng.nextInt(5));
+            }
+            return genome;
+        }
+
+        // a genome from words saved by getWords()
+        static Genome fromWords(const std::uint64_t* words)
+        {
+            Genome genome {};
+
+            for (std::size_t i {0}; i < WORD_COUNT; ++i)
+            {
+                genome.m_words[i] = words[i];
+            }
+            return genome;
+        }
+
+        // slot 0-3 is a sensor state, slot 4 is the action code
+        int getState(std::size_t gene, std::size_t slot) const
+        {
+            return static_cast<int>((m_words[gene / GENES_PER_WORD] >> shiftOf(gene, slot)) & maskOf(slot));
+        }
+
+        void setState(std::size_t gene, std::size_t slot, int value)
+        {
+            std::uint64_t& word {m_words[gene / GENES_PER_WORD]};
+            word &= ~(maskOf(slot) << shiftOf(gene, slot));
+            word |= (static_cast<std::uint64_t>(value) & maskOf(slot)) << shiftOf(gene, slot);
+        }
+
+        const std::array<std::uint64_t, WORD_COUNT>& getWords() const {return m_words;}
+
+        // get the top half of parent genes
+        Half getGenesTopHalf() const
+        {
+            Half topHalf {};
+
+            for (std::size_t i {0}; i < topHalf.size(); ++i)
+            {
+                topHalf[i] = m_words[i];
+            }
+            return topHalf;
+        }
+
+        // get the bottom half of parent genes
+        Half getGenesBottomHalf() const
+        {
+            Half bottomHalf {};
+
+            for (std::size_t i {0}; i < bottomHalf.size(); ++i)
+            {
+                bottomHalf[i] = m_words[i + bottomHalf.size()];
+            }
+            return bottomHalf;
+        }
+
+        // set the child genes using the top half and bottom half of the parent genes
+        void setChildGenes(const Half& topHalf, const Half& bottomHalf, Rng& rng, int mutationPercent = DEFAULT_MUTATION_PERCENT)
+        {
+            setGenes(topHalf, bottomHalf);
+            mutate(rng, mutationPercent);
+        }
+
+        // the crossover half of setChildGenes()
+        void setGenes(const Half& topHalf, const Half& bottomHalf)
+        {
+            for (std::size_t i {0}; i < topHalf.size(); ++i)
+            {
+                m_words[i] = topHalf[i];
+                m_words[i + topHalf.size()] = bottomHalf[i];
+            }
+        }
+
+        // the mutation half of setChildGenes(), always draws the same 4 numbers
+        void mutate(Rng& rng, int mutationPercent = DEFAULT_MUTATION_PERCENT)
+        {
+            int mutationProbability {rng.nextInt(100)};
+            int geneToMutateIndex {rng.nextInt(static_cast<int>(GENE_COUNT))};
+            int sensorStateToMutateIndex {rng.nextInt(4)};
+            int mutationValue {rng.nextInt(3)};
+
+            if (mutationProbability < mutationPercent) {
+                // 5% chance by default
+                setState(static_cast<std::size_t>(geneToMutateIndex), static_cast<std::size_t>(sensorStateToMutateIndex), mutationValue);
+            }
+        }
+
+        // a gene only ever matches one sensor reading, so the table can be filled by writing
+        // the fallback action everywhere and then writing the genes from last to first,
+        // which leaves the first matching gene in each slot just like the old linear scan
+        std::array<std::uint8_t, SENSOR_STATES> compileActionTable() const
+        {
+            std::array<std::uint8_t, SENSOR_STATES> actionTable {};
+            actionTable.fill(static_cast<std::uint8_t>(getState(GENE_COUNT - 1, ACTION_SLOT)));
+
+            for (std::size_t i {GENE_COUNT}; i-- > 0;)
+            {
+                actionTable[sensorIndex(getState(i, North), getState(i, South), getState(i, East), getState(i, West))] = static_cast<std::uint8_t>(getState(i, ACTION_SLOT));
+            }
+            return actionTable;
+        }
+
+        // display the genes, one gene per line
+        // the text is built first and written in one go instead of a character at a time
+        void displayGenes(std::ostream& out = std::cout) const
+        {
+            std::string text {};
+            text.reserve(GENE_COUNT * (ACTION_SLOT + 1) * 2 + GENE_COUNT);
+
+            for (std::size_t i {0}; i < GENE_COUNT; ++i)
+            {
+                for (std::size_t j {0}; j <= ACTION_SLOT; ++j)
+                {
+                    text += static_cast<char>('0' + getState(i, j));
+                    text += ' ';
+                }
+                text += '\n';
+            }
+            out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        }
+
+        friend bool operator==(const Genome& a, const Genome& b) {return a.m_words == b.m_words;}
+        friend bool operator!=(const Genome& a, const Genome& b) {return a.m_words != b.m_words;}
+};
+
+// the original robots have 16 genes
+constexpr std::size_t DEFAULT_GENE_COUNT {16};
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// the size of the world a robot lives in
+// x is the row and goes from 1 to height, y is the column and goes from 1 to width,
+// and a ring of walls is put around the outside so a grid has 2 more rows and columns
+// than its width and height
+//
+// FixedGrid has everything known at compile time so the common sizes get constant
+// offsets and array storage, DynamicGrid has the same functions but picks them at run time
+
+// one bit per spot for grids only known at run time
+class DynamicBitSet
+{
+    private:
+        std::vector<std::uint64_t> m_words {};
+    public:
+        DynamicBitSet() = default;
+
+        explicit DynamicBitSet(std::size_t size)
+        : m_words((size + 63) / 64)
+        {
+        }
+
+        bool test(std::size_t i) const {return (m_words[i / 64] >> (i % 64)) & 1;}
+        void set(std::size_t i) {m_words[i / 64] |= std::uint64_t {1} << (i % 64);}
+
+        // clear every bit without giving the memory back
+        void reset()
+        {
+            for (std::uint64_t& word : m_words)
+            {
+                word = 0;
+            }
+        }
+};
+
+template <int Width, int Height, int BatteryPercent>
+struct FixedGrid
+{
+    static_assert(Width > 0 && Height > 0, "a grid needs at least one spot");
+    static_assert(BatteryPercent >= 0 && BatteryPercent < 100, "robots need an empty spot to spawn on");
+
+    static constexpr bool IS_FIXED {true};
+
+    template <typename T>
+    using CellArray = std::array<T, static_cast<std::size_t>((Width + 2) * (Height + 2))>;
+    using SpotSet = std::bitset<static_cast<std::size_t>(Width * Height)>;
+
+    static constexpr int width() {return Width;}
+    static constexpr int height() {return Height;}
+    static constexpr int batteryPercent() {return BatteryPercent;}
+
+    // the number of batteries placed on a layout
+    static constexpr int batteryCount() {return Width * Height * BatteryPercent / 100;}
+
+    // distance between two rows, including the walls
+    static constexpr int rowLength() {return Width + 2;}
+    static constexpr std::size_t cellCount() {return static_cast<std::size_t>((Width + 2) * (Height + 2));}
+    static constexpr std::size_t spotCount() {return static_cast<std::size_t>(Width * Height);}
+
+    // where (x, y) is in an array of every cell, walls included
+    static constexpr std::size_t cellIndex(int x, int y) {return static_cast<std::size_t>(x * rowLength() + y);}
+
+    // where (x, y) is in a set of the spots inside the walls
+    static constexpr std::size_t spotIndex(int x, int y) {return static_cast<std::size_t>((x - 1) * Width + (y - 1));}
+
+    template <typename T>
+    CellArray<T> makeCellArray() const {return CellArray<T> {};}
+    SpotSet makeSpotSet() const {return SpotSet {};}
+};
+
+class DynamicGrid
+{
+    private:
+        int m_width {10};
+        int m_height {10};
+        int m_batteryPercent {40};
+    public:
+        static constexpr bool IS_FIXED {false};
+
+        template <typename T>
+        using CellArray = std::vector<T>;
+        using SpotSet = DynamicBitSet;
+
+        DynamicGrid() = default;
+
+        DynamicGrid(int width, int height, int batteryPercent)
+        : m_width {width}
+        , m_height {height}
+        , m_batteryPercent {batteryPercent}
+        {
+        }
+
+        int width() const {return m_width;}
+        int height() const {return m_height;}
+        int batteryPercent() const {return m_batteryPercent;}
+
+        int batteryCount() const {return m_width * m_height * m_batteryPercent / 100;}
+
+        int rowLength() const {return m_width + 2;}
+        std::size_t cellCount() const {return static_cast<std::size_t>(m_width + 2) * static_cast<std::size_t>(m_height + 2);}
+        std::size_t spotCount() const {return static_cast<std::size_t>(m_width) * static_cast<std::size_t>(m_height);}
+
+        std::size_t cellIndex(int x, int y) const {return static_cast<std::size_t>(x) * static_cast<std::size_t>(rowLength()) + static_cast<std::size_t>(y);}
+        std::size_t spotIndex(int x, int y) const {return static_cast<std::size_t>(x - 1) * static_cast<std::size_t>(m_width) + static_cast<std::size_t>(y - 1);}
+
+        template <typename T>
+        CellArray<T> makeCellArray() const {return CellArray<T>(cellCount());}
+        SpotSet makeSpotSet() const {return SpotSet {spotCount()};}
+};
+
+// the original 10x10 world with 40 percent of it covered in batteries
+using DefaultGrid = FixedGrid<10, 10, 40>;
+
+#endif
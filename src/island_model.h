@@ -0,0 +1,212 @@
+#ifndef ISLAND_MODEL_H
+#define ISLAND_MODEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "evaluation_arena.h"
+#include "genetic_algorithm.h"
+#include "genome.h"
+#include "map.h"
+#include "population.h"
+#include "rng.h"
+#include "spsc_queue.h"
+#include "stats.h"
+
+// several populations evolving side by side, each on its own thread
+// the islands are connected in a ring: every few generations an island sends copies of
+// its best genomes to the next island and takes in whatever the previous one sent
+//
+// nothing ever waits on another island, a full queue drops the migrants and an empty
+// queue is skipped, so only the migration part of a run depends on thread timing
+struct IslandSettings
+{
+    std::size_t islandCount {4};
+    std::size_t populationSize {200};
+    int generations {100};
+    int mutationPercent {DEFAULT_MUTATION_PERCENT};
+
+    // send migrants every this many generations
+    int migrationInterval {10};
+    // how many of the best robots are sent each time
+    std::size_t migrantCount {5};
+
+    std::size_t sharedLayoutCount {0};
+    std::size_t trials {1};
+    bool batched {false};
+};
+
+template <typename Grid, std::size_t GeneCount>
+class Island
+{
+    public:
+        using MigrationQueue = SpscQueue<Genome<GeneCount>>;
+    private:
+        IslandSettings m_settings {};
+        Rng m_rng {};
+        Rng m_evaluationRng {};
+        LayoutSource<Grid> m_layouts;
+        Population<Grid, GeneCount> m_robots;
+        EvaluationArena<Grid, GeneCount> m_arena;
+
+        MigrationQueue* m_inbound {nullptr};
+        MigrationQueue* m_outbound {nullptr};
+
+        // what happened each generation, read once the island's thread is done
+        std::vector<double> m_averageFitness {};
+        std::vector<PhaseTimes> m_times {};
+        std::vector<SimulationCounters> m_counters {};
+        std::size_t m_migrantsSent {};
+        std::size_t m_migrantsReceived {};
+
+        // the best robots are at the front after sortVector() and stay there through breeding
+        void sendMigrants()
+        {
+            for (std::size_t i {0}; i < m_settings.migrantCount && i < m_robots.size(); ++i)
+            {
+                if (!m_outbound->tryPush(m_robots.getGenome(i)))
+                    break;
+                ++m_migrantsSent;
+            }
+        }
+
+        // migrants take the place of the newest children, which have not been scored yet,
+        // so they are evaluated on this island next generation like any other child
+        void receiveMigrants()
+        {
+            std::size_t replaced {0};
+            Genome<GeneCount> migrant {};
+
+            while (replaced < m_settings.migrantCount && replaced < m_robots.size() && m_inbound->tryPop(migrant))
+            {
+                ++replaced;
+                m_robots.getGenome(m_robots.size() - replaced) = migrant;
+            }
+            m_migrantsReceived += replaced;
+        }
+    public:
+        Island(const Grid& grid, std::uint32_t seed, const IslandSettings& settings)
+        : m_settings {settings}
+        , m_rng {seed}
+        , m_evaluationRng {m_rng.nextSeed()}
+        , m_layouts {grid, settings.sharedLayoutCount, m_rng}
+        , m_robots {settings.populationSize, m_layouts, m_rng}
+        , m_arena {grid}
+        {
+            m_robots.returnLayoutsTo(m_layouts);
+        }
+
+        // the queue this island takes migrants from and the one it sends them to
+        void connect(MigrationQueue& inbound, MigrationQueue& outbound)
+        {
+            m_inbound = &inbound;
+            m_outbound = &outbound;
+        }
+
+        // the same generation loop as main(), with migration after breeding
+        void run()
+        {
+            for (int generation {0}; generation < m_settings.generations; ++generation)
+            {
+                PhaseTimer timer {};
+                PhaseTimes times {};
+
+                if (m_settings.batched)
+                    m_arena.evaluateRangeBatched(m_robots, 0, m_robots.size(), m_layouts, m_settings.trials, m_evaluationRng);
+                else
+                    m_arena.evaluateRange(m_robots, 0, m_robots.size(), m_layouts, m_settings.trials, m_evaluationRng);
+                times.evaluate = timer.lap();
+
+                double totalFitness {};
+                for (std::size_t i {0}; i < m_robots.size(); ++i)
+                {
+                    totalFitness += m_robots.getFitness(i);
+                }
+                m_averageFitness.push_back(totalFitness / static_cast<double>(m_robots.size()));
+
+                timer.lap();
+                sortVector(m_robots);
+                times.sort = timer.lap();
+                destroyBottom50Percent(m_robots);
+                times.cull = timer.lap();
+                breedRobots(m_robots, m_layouts, m_rng, m_settings.mutationPercent);
+                times.breed = timer.lap();
+
+                if (m_outbound && (generation + 1) % m_settings.migrationInterval == 0)
+                    sendMigrants();
+                if (m_inbound)
+                    receiveMigrants();
+
+                SimulationCounters counters {};
+                m_arena.takeCounters(counters);
+                m_counters.push_back(counters);
+                m_times.push_back(times);
+            }
+        }
+
+        // getter functions
+        double getAverageFitness(int generation) const {return m_averageFitness[static_cast<std::size_t>(generation)];}
+        const PhaseTimes& getTimes(int generation) const {return m_times[static_cast<std::size_t>(generation)];}
+        const SimulationCounters& getCounters(int generation) const {return m_counters[static_cast<std::size_t>(generation)];}
+        std::size_t getMigrantsSent() const {return m_migrantsSent;}
+        std::size_t getMigrantsReceived() const {return m_migrantsReceived;}
+};
+
+// the islands and the ring of queues between them
+template <typename Grid, std::size_t GeneCount>
+class IslandModel
+{
+    public:
+        using IslandType = Island<Grid, GeneCount>;
+    private:
+        IslandSettings m_settings {};
+        std::vector<std::unique_ptr<IslandType>> m_islands {};
+        // m_queues[i] carries migrants from island i to island i + 1
+        std::vector<std::unique_ptr<typename IslandType::MigrationQueue>> m_queues {};
+    public:
+        // every island is seeded from rng, so the islands are set up the same way every run
+        IslandModel(const Grid& grid, const IslandSettings& settings, Rng& rng)
+        : m_settings {settings}
+        {
+            for (std::size_t i {0}; i < settings.islandCount; ++i)
+            {
+                m_islands.push_back(std::make_unique<IslandType>(grid, rng.nextSeed(), settings));
+                // room for a few rounds of migrants in case the next island falls behind
+                m_queues.push_back(std::make_unique<typename IslandType::MigrationQueue>(settings.migrantCount * 4));
+            }
+
+            // a single island has nobody to trade with
+            if (settings.islandCount < 2)
+                return;
+
+            for (std::size_t i {0}; i < settings.islandCount; ++i)
+            {
+                std::size_t previous {(i + settings.islandCount - 1) % settings.islandCount};
+                m_islands[i]->connect(*m_queues[previous], *m_queues[i]);
+            }
+        }
+
+        // run every island on its own thread until all of them are done
+        void run()
+        {
+            std::vector<std::thread> threads {};
+            threads.reserve(m_islands.size());
+            for (std::unique_ptr<IslandType>& island : m_islands)
+            {
+                threads.emplace_back(&IslandType::run, island.get());
+            }
+
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        std::size_t size() const {return m_islands.size();}
+        const IslandType& getIsland(std::size_t i) const {return *m_islands[i];}
+};
+
+#endif
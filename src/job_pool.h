@@ -0,0 +1,184 @@
+#ifndef JOB_POOL_H
+#define JOB_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed size pool of worker threads for jobs that take very different amounts of time
+// unlike ThreadPool, which splits one loop into equal ranges, every job here is queued
+// on its own and a worker that runs out of jobs steals from the other workers' queues,
+// so one long job never leaves the rest of the machine waiting behind it
+//
+// jobs are whole runs, so each queue is a plain deque behind its own lock, the locks
+// are taken once per job and never show up next to the jobs themselves
+class JobPool
+{
+    public:
+        // the index of the worker running the job
+        using Job = std::function<void(std::size_t)>;
+    private:
+        struct JobQueue
+        {
+            std::mutex mutex {};
+            std::deque<Job> jobs {};
+        };
+
+        std::vector<std::unique_ptr<JobQueue>> m_queues {};
+        std::vector<std::thread> m_workers {};
+        std::mutex m_mutex {};
+        std::condition_variable m_workCondition {};
+        std::condition_variable m_doneCondition {};
+        // jobs waiting in a queue, and jobs not finished yet including the running ones
+        std::size_t m_queuedJobs {};
+        std::size_t m_unfinishedJobs {};
+        std::size_t m_nextQueue {};
+        std::size_t m_steals {};
+        bool m_stopping {false};
+
+        // a worker runs its own jobs in the order they were submitted
+        bool takeOwn(std::size_t worker, Job& job)
+        {
+            JobQueue& queue {*m_queues[worker]};
+            std::lock_guard<std::mutex> lock {queue.mutex};
+            if (queue.jobs.empty())
+                return false;
+
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            return true;
+        }
+
+        // and steals from the far end of the next busy worker's queue, away from where
+        // that worker is taking its own
+        bool steal(std::size_t worker, Job& job)
+        {
+            for (std::size_t offset {1}; offset < m_queues.size(); ++offset)
+            {
+                JobQueue& queue {*m_queues[(worker + offset) % m_queues.size()]};
+                std::lock_guard<std::mutex> lock {queue.mutex};
+                if (queue.jobs.empty())
+                    continue;
+
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+                return true;
+            }
+            return false;
+        }
+
+        void workerLoop(std::size_t worker)
+        {
+            while (true)
+            {
+                Job job {};
+                bool own {takeOwn(worker, job)};
+                if (own || steal(worker, job))
+                {
+                    {
+                        std::lock_guard<std::mutex> lock {m_mutex};
+                        --m_queuedJobs;
+                        if (!own)
+                            ++m_steals;
+                    }
+
+                    job(worker);
+
+                    bool finished {false};
+                    {
+                        std::lock_guard<std::mutex> lock {m_mutex};
+                        finished = --m_unfinishedJobs == 0;
+                    }
+                    if (finished)
+                        m_doneCondition.notify_all();
+                    continue;
+                }
+
+                // a job submitted after the queues were checked is counted by now, so
+                // the wait below does not miss it
+                std::unique_lock<std::mutex> lock {m_mutex};
+                m_workCondition.wait(lock, [&] { return m_stopping || m_queuedJobs > 0; });
+                if (m_stopping && m_queuedJobs == 0)
+                    return;
+            }
+        }
+    public:
+        // 0 threads means use every core on the machine
+        explicit JobPool(std::size_t threadCount)
+        {
+            if (threadCount == 0)
+                threadCount = std::thread::hardware_concurrency();
+            if (threadCount == 0)
+                threadCount = 1;
+
+            for (std::size_t i {0}; i < threadCount; ++i)
+            {
+                m_queues.push_back(std::make_unique<JobQueue>());
+            }
+
+            m_workers.reserve(threadCount);
+            for (std::size_t i {0}; i < threadCount; ++i)
+            {
+                m_workers.emplace_back(&JobPool::workerLoop, this, i);
+            }
+        }
+
+        JobPool(const JobPool&) = delete;
+        JobPool& operator=(const JobPool&) = delete;
+
+        // queued jobs are still run before the workers stop
+        ~JobPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock {m_mutex};
+                m_stopping = true;
+            }
+            m_workCondition.notify_all();
+
+            for (std::thread& worker : m_workers)
+            {
+                worker.join();
+            }
+        }
+
+        std::size_t size() const {return m_workers.size();}
+
+        // jobs are dealt out to the workers' queues in turn
+        void submit(Job job)
+        {
+            {
+                // the job is counted before a worker can take it and count it off again
+                std::lock_guard<std::mutex> lock {m_mutex};
+                JobQueue& queue {*m_queues[m_nextQueue]};
+                m_nextQueue = (m_nextQueue + 1) % m_queues.size();
+                {
+                    std::lock_guard<std::mutex> queueLock {queue.mutex};
+                    queue.jobs.push_back(std::move(job));
+                }
+                ++m_queuedJobs;
+                ++m_unfinishedJobs;
+            }
+            m_workCondition.notify_all();
+        }
+
+        // block until every job submitted so far is finished
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock {m_mutex};
+            m_doneCondition.wait(lock, [&] { return m_unfinishedJobs == 0; });
+        }
+
+        // how many jobs were run by a worker they were not dealt to
+        std::size_t getSteals()
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            return m_steals;
+        }
+};
+
+#endif
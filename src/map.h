@@ -0,0 +1,545 @@
+#ifndef MAP_H
+#define MAP_H
+
+#include <iostream>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "grid.h"
+#include "rng.h"
+#include "stats.h"
+#include "thread_pool.h"
+
+// code representation
+constexpr int EMPTY {0};
+constexpr int WALL {1};
+constexpr int BATTERY {2};
+
+
+enum Direction
+{
+    North, // 0
+    South, // 1
+    East, // 2
+    West, // 3
+
+    RandomDir
+};
+
+// turns a code back into the character used when printing a map
+constexpr char tileChar(int code)
+{
+    switch (code)
+    {
+    case WALL:
+        return 'W';
+    case BATTERY:
+        return 'B';
+    default:
+        return '-';
+    }
+}
+
+// every sensor reads one of 3 codes in 4 directions, so there are 3^4 = 81 possible readings
+constexpr std::size_t SENSOR_STATES {81};
+
+// the sensor reading packed into one number: north * 27 + south * 9 + east * 3 + west
+constexpr std::size_t sensorIndex(int north, int south, int east, int west)
+{
+    return static_cast<std::size_t>(((north * 3 + south) * 3 + east) * 3 + west);
+}
+
+// coordinates to show location on the grid
+struct Coordinates
+{
+    int x {};
+    int y {};
+};
+
+// where the walls and batteries start out, generated once from a seed and never changed
+// many robots can share one layout since each of them tracks what it ate in its own Map
+// every spot is stored as the code the sensor reports for it
+template <typename Grid>
+class BatteryLayout
+{
+    private:
+        Grid m_grid {};
+        typename Grid::template CellArray<std::uint8_t> m_map {};
+        std::uint32_t m_seed {};
+
+        // every spot inside the walls in some order, plus where each swap of the last
+        // shuffle took its spot from
+        // generate() swaps the battery spots to the front and then undoes the swaps, so the
+        // order is the same every time and a seed always gives the same layout
+        struct SpotShuffle
+        {
+            std::vector<std::uint32_t> spots {};
+            std::vector<std::uint32_t> swappedWith {};
+        };
+
+        // one per thread, so layouts can be generated in parallel without allocating
+        static SpotShuffle& spotShuffle(std::size_t spotCount)
+        {
+            static thread_local SpotShuffle shuffle {};
+            if (shuffle.spots.size() != spotCount)
+            {
+                shuffle.spots.resize(spotCount);
+                for (std::size_t i {0}; i < spotCount; ++i)
+                {
+                    shuffle.spots[i] = static_cast<std::uint32_t>(i);
+                }
+            }
+            return shuffle;
+        }
+    public:
+        explicit BatteryLayout(const Grid& grid = Grid {})
+        : m_grid {grid}
+        , m_map {grid.template makeCellArray<std::uint8_t>()}
+        {
+        }
+
+        BatteryLayout(const Grid& grid, std::uint32_t seed)
+        : BatteryLayout {grid}
+        {
+            generate(seed);
+        }
+
+        // build the layout for a seed in place, so scratch layouts can be reused
+        void generate(std::uint32_t seed)
+        {
+            m_seed = seed;
+            Rng rng {seed};
+
+            for (int i {0}; i < m_grid.height() + 2; ++i)
+            {
+                for (int j {0}; j < m_grid.width() + 2; ++j)
+                {
+                    // place the walls at the edges of the map
+                    if (i == 0 || i == m_grid.height() + 1 || j == 0 || j == m_grid.width() + 1)
+                    {
+                        m_map[m_grid.cellIndex(i, j)] = WALL;
+                    }
+                    // put empty spots everywhere else
+                    else
+                    {
+                        m_map[m_grid.cellIndex(i, j)] = EMPTY;
+                    }
+                }
+            }
+
+            // 40 percent of the map = 40 batteries on the 10x10 grid
+            std::size_t batteries {static_cast<std::size_t>(m_grid.batteryCount())};
+            std::size_t spotCount {m_grid.spotCount()};
+
+            // place the batteries with a partial Fisher-Yates shuffle of the spots, one draw
+            // per battery and no retrying on spots that already have one
+            SpotShuffle& shuffle {spotShuffle(spotCount)};
+            shuffle.swappedWith.resize(batteries);
+            for (std::size_t i {0}; i < batteries; ++i)
+            {
+                std::size_t j {i + static_cast<std::size_t>(rng.nextInt(static_cast<int>(spotCount - i)))};
+                std::swap(shuffle.spots[i], shuffle.spots[j]);
+                shuffle.swappedWith[i] = static_cast<std::uint32_t>(j);
+
+                int spot {static_cast<int>(shuffle.spots[i])};
+                m_map[m_grid.cellIndex(1 + spot / m_grid.width(), 1 + spot % m_grid.width())] = BATTERY;
+            }
+
+            for (std::size_t i {batteries}; i > 0; --i)
+            {
+                std::swap(shuffle.spots[i - 1], shuffle.spots[shuffle.swappedWith[i - 1]]);
+            }
+        }
+
+        const Grid& getGrid() const {return m_grid;}
+        std::uint32_t getSeed() const {return m_seed;}
+
+        // the whole grid as sensor codes, one byte per spot in row order
+        const typename Grid::template CellArray<std::uint8_t>& getSensorCodes() const {return m_map;}
+
+        // what was at a position before any robot moved
+        int getCode(int x, int y) const
+        {
+            return m_map[m_grid.cellIndex(x, y)];
+        }
+
+        // position is empty if it has no wall or battery
+        bool isPositionEmpty(int x, int y) const
+        {
+            return getCode(x, y) == EMPTY;
+        }
+
+        // pick a random empty spot for a robot to spawn on
+        Coordinates spawnRobot(Rng& rng) const
+        {
+            Coordinates coordinates {};
+            int batteries {m_grid.batteryCount()};
+            int spots {m_grid.width() * m_grid.height()};
+
+            // with at most half of the spots taken a random spot is empty at least half of
+            // the time, so trying again is cheaper than looking for an empty spot
+            if (batteries * 2 <= spots)
+            {
+                // will show if the position is empty or not
+                bool validPosition {false};
+
+                // keep generating random coordinates until it is a valid coordinate
+                while (!validPosition)
+                {
+                    // robots will spawn anywhere inside the walls
+                    coordinates.x = 1 + rng.nextInt(m_grid.height());
+                    coordinates.y = 1 + rng.nextInt(m_grid.width());
+
+                    if (isPositionEmpty(coordinates.x, coordinates.y))
+                        validPosition = true;
+                }
+                return coordinates;
+            }
+
+            // otherwise take the nth empty spot in row order
+            int skip {rng.nextInt(spots - batteries)};
+            for (coordinates.x = 1; coordinates.x <= m_grid.height(); ++coordinates.x)
+            {
+                for (coordinates.y = 1; coordinates.y <= m_grid.width(); ++coordinates.y)
+                {
+                    if (isPositionEmpty(coordinates.x, coordinates.y) && skip-- == 0)
+                        return coordinates;
+                }
+            }
+            return coordinates;
+        }
+};
+
+// hands out layouts to new robots
+// with no shared layouts every robot gets a brand new one like before, otherwise
+// every robot picks one of a fixed pool made up front and breeding only copies a pointer
+// the pool is indexed by seed, so saved robots and worker processes find their layout
+// without searching the pool
+//
+// a brand new layout is regenerated in place in one that no robot holds any more when
+// there is one, so once the population stops growing handing out layouts never allocates
+// a population hands back the layouts it lets go of with release(), see
+// Population::returnLayoutsTo(), so finding a free one never has to search
+template <typename Grid>
+class LayoutSource
+{
+    private:
+        Grid m_grid {};
+        std::vector<std::shared_ptr<const BatteryLayout<Grid>>> m_sharedLayouts {};
+        std::unordered_map<std::uint32_t, std::size_t> m_sharedIndex {};
+        // layouts made for a single robot that no robot holds any more
+        std::vector<std::shared_ptr<BatteryLayout<Grid>>> m_freeLayouts {};
+
+        std::shared_ptr<const BatteryLayout<Grid>> freshLayout(std::uint32_t seed)
+        {
+            if (m_freeLayouts.empty())
+                return std::make_shared<BatteryLayout<Grid>>(m_grid, seed);
+
+            std::shared_ptr<BatteryLayout<Grid>> layout {std::move(m_freeLayouts.back())};
+            m_freeLayouts.pop_back();
+            layout->generate(seed);
+            return layout;
+        }
+
+        void buildSharedLayouts(const std::vector<std::uint32_t>& seeds, ThreadPool* pool)
+        {
+            m_sharedLayouts.resize(seeds.size());
+            auto build = [&](std::size_t begin, std::size_t end, std::size_t)
+            {
+                for (std::size_t i {begin}; i < end; ++i)
+                {
+                    m_sharedLayouts[i] = std::make_shared<const BatteryLayout<Grid>>(m_grid, seeds[i]);
+                }
+            };
+            if (pool)
+                pool->parallelFor(seeds.size(), build);
+            else
+                build(0, seeds.size(), 0);
+
+            // two layouts with the same seed are the same, the first one is used for both
+            m_sharedIndex.reserve(seeds.size());
+            for (std::size_t i {0}; i < seeds.size(); ++i)
+            {
+                m_sharedIndex.emplace(seeds[i], i);
+            }
+        }
+    public:
+        // the seeds are drawn from rng one after another, a thread pool only shares out
+        // the work of building the layouts
+        LayoutSource(const Grid& grid, std::size_t sharedLayoutCount, Rng& rng, ThreadPool* pool = nullptr)
+        : m_grid {grid}
+        {
+            std::vector<std::uint32_t> seeds {};
+            seeds.reserve(sharedLayoutCount);
+            for (std::size_t i {0}; i < sharedLayoutCount; ++i)
+            {
+                seeds.push_back(rng.nextSeed());
+            }
+            buildSharedLayouts(seeds, pool);
+        }
+
+        // rebuild a source from the seeds of its shared layouts
+        LayoutSource(const Grid& grid, const std::vector<std::uint32_t>& sharedSeeds, ThreadPool* pool = nullptr)
+        : m_grid {grid}
+        {
+            buildSharedLayouts(sharedSeeds, pool);
+        }
+
+        const Grid& getGrid() const {return m_grid;}
+        std::size_t getSharedLayoutCount() const {return m_sharedLayouts.size();}
+
+        std::vector<std::uint32_t> getSharedSeeds() const
+        {
+            std::vector<std::uint32_t> seeds {};
+            seeds.reserve(m_sharedLayouts.size());
+            for (const std::shared_ptr<const BatteryLayout<Grid>>& layout : m_sharedLayouts)
+            {
+                seeds.push_back(layout->getSeed());
+            }
+            return seeds;
+        }
+
+        // the layout a saved robot was on, shared again if it was one of the shared ones
+        std::shared_ptr<const BatteryLayout<Grid>> layoutForSeed(std::uint32_t seed)
+        {
+            std::unordered_map<std::uint32_t, std::size_t>::const_iterator shared {m_sharedIndex.find(seed)};
+            if (shared != m_sharedIndex.end())
+                return m_sharedLayouts[shared->second];
+            return freshLayout(seed);
+        }
+
+        // let go of a robot's layout, if nothing else holds it it is kept for the next
+        // brand new layout, shared layouts are always held by this source as well
+        void release(std::shared_ptr<const BatteryLayout<Grid>>& layout)
+        {
+            if (layout.use_count() == 1)
+                m_freeLayouts.push_back(std::const_pointer_cast<BatteryLayout<Grid>>(std::move(layout)));
+            layout.reset();
+        }
+
+        std::shared_ptr<const BatteryLayout<Grid>> nextLayout(Rng& rng)
+        {
+            if (m_sharedLayouts.empty())
+                return freshLayout(rng.nextSeed());
+
+            return m_sharedLayouts[static_cast<std::size_t>(rng.nextInt(static_cast<int>(m_sharedLayouts.size())))];
+        }
+
+        // a layout for one extra evaluation trial
+        // shared layouts are picked like nextLayout(), otherwise scratch is rebuilt in place
+        // so extra trials never allocate
+        const BatteryLayout<Grid>& trialLayout(BatteryLayout<Grid>& scratch, Rng& rng) const
+        {
+            if (m_sharedLayouts.empty())
+            {
+                scratch.generate(rng.nextSeed());
+                return scratch;
+            }
+
+            return *m_sharedLayouts[static_cast<std::size_t>(rng.nextInt(static_cast<int>(m_sharedLayouts.size())))];
+        }
+};
+
+// one robot's view of a shared layout
+// only the batteries this robot has eaten are stored, one bit per spot inside the walls
+template <typename Grid>
+class Map
+{
+    private:
+        const BatteryLayout<Grid>* m_layout {nullptr};
+        typename Grid::SpotSet m_consumed {};
+
+        // the robot moves from (x, y) to (newX, newY) unless there is a wall in the way
+        // will still consume energy when it bumps into the wall
+        void moveTo(int& x, int& y, int newX, int newY, int& power, int& turnsSurvived, int& powerHarvested)
+        {
+            --power;
+            ++turnsSurvived;
+            GA_COUNT(steps, 1);
+
+            // keep the robot in the same place if it is trying to move into a wall
+            int code {getCode(newX, newY)};
+            if (code == WALL)
+            {
+                GA_COUNT(wallBumps, 1);
+                return;
+            }
+
+            if (code == BATTERY)
+            {
+                // robot gains 5 power when consuming battery
+                GA_COUNT(batteryPickups, 1);
+                power+=5;
+                powerHarvested+=5;
+                m_consumed.set(m_layout->getGrid().spotIndex(newX, newY));
+            }
+
+            x = newX;
+            y = newY;
+        }
+    public:
+        explicit Map(const BatteryLayout<Grid>& layout)
+        : m_layout {&layout}
+        , m_consumed {layout.getGrid().makeSpotSet()}
+        {
+        }
+
+        // move onto another layout of the same grid with every battery back in place
+        void reset(const BatteryLayout<Grid>& layout)
+        {
+            m_layout = &layout;
+            m_consumed.reset();
+        }
+
+        const Grid& getGrid() const {return m_layout->getGrid();}
+
+        // what is at a position right now, batteries disappear once this robot eats them
+        int getCode(int x, int y) const
+        {
+            int code {m_layout->getCode(x, y)};
+            if (code == BATTERY && m_consumed.test(m_layout->getGrid().spotIndex(x, y)))
+                return EMPTY;
+            return code;
+        }
+
+        // getCode() for sensors that reach further than the ring of walls, anything past
+        // it reads as a wall too
+        int getCodeOrWall(int x, int y) const
+        {
+            const Grid& grid {m_layout->getGrid()};
+            if (x < 0 || y < 0 || x > grid.height() + 1 || y > grid.width() + 1)
+                return WALL;
+            return getCode(x, y);
+        }
+
+        // get the coordinate above the current robot position
+        int getNorthCoordinate(int x, int y) const
+        {
+            return getCode(x - 1, y);
+        }
+
+        // get the coordinate below the current robot position
+        int getSouthCoordinate(int x, int y) const
+        {
+            return getCode(x + 1, y);
+        }
+
+        // get the coordinate to the right of the current robot position
+        int getEastCoordinate(int x, int y) const
+        {
+            return getCode(x, y + 1);
+        }
+
+        // get the coordinate to the left of the current robot position
+        int getWestCoordinate(int x, int y) const
+        {
+            return getCode(x, y - 1);
+        }
+
+        void moveNorth(int& x, int& y, int& power, int& turnsSurvived, int& powerHarvested)
+        {
+            moveTo(x, y, x - 1, y, power, turnsSurvived, powerHarvested);
+        }
+
+        void moveSouth(int& x, int& y, int& power, int& turnsSurvived, int& powerHarvested)
+        {
+            moveTo(x, y, x + 1, y, power, turnsSurvived, powerHarvested);
+        }
+
+        void moveEast(int& x, int& y, int& power, int& turnsSurvived, int& powerHarvested)
+        {
+            moveTo(x, y, x, y + 1, power, turnsSurvived, powerHarvested);
+        }
+
+        void moveWest(int& x, int& y, int& power, int& turnsSurvived, int& powerHarvested)
+        {
+            moveTo(x, y, x, y - 1, power, turnsSurvived, powerHarvested);
+        }
+
+        void moveRandom(int& x, int& y, int& power, int& turnsSurvived, int& powerHarvested, Rng& rng)
+        {
+            // get a random number used to choose the direction
+            int randomNum {rng.nextInt(4)};
+
+            switch (randomNum)
+            {
+            case 0:
+                moveNorth(x, y, power, turnsSurvived, powerHarvested);
+                break;
+            case 1:
+                moveSouth(x, y, power, turnsSurvived, powerHarvested);
+                break;
+            case 2:
+                moveEast(x, y, power, turnsSurvived, powerHarvested);
+                break;
+            case 3:
+                moveWest(x, y, power, turnsSurvived, powerHarvested);
+                break;
+            }
+        }
+
+        // move the robot based on what the action code tells it to do
+        void move(int actionCode, int& x, int& y, int& power, int& turnsSurvived, int& powerHarvested, Rng& rng)
+        {
+            switch (actionCode)
+            {
+                // 0
+            case North:
+                moveNorth(x, y, power, turnsSurvived, powerHarvested);
+                break;
+                // 1
+            case South:
+                moveSouth(x, y, power, turnsSurvived, powerHarvested);
+                break;
+                // 2
+            case East:
+                moveEast(x, y, power, turnsSurvived, powerHarvested);
+                break;
+                // 3
+            case West:
+                moveWest(x, y, power, turnsSurvived, powerHarvested);
+                break;
+                // Random direction
+            case RandomDir:
+                GA_COUNT(randomActions, 1);
+                moveRandom(x, y, power, turnsSurvived, powerHarvested, rng);
+                break;
+            }
+        }
+
+        // the robot is drawn as 'R' at its current position
+        void displayMap(Coordinates robot, std::ostream& out = std::cout) const
+        {
+            const Grid& grid {m_layout->getGrid()};
+
+            // built first and written in one go, a big grid is a lot of characters
+            std::string text {};
+            text.reserve(grid.cellCount() * 2 + static_cast<std::size_t>(grid.height() + 2));
+
+            // row
+            for (int i {0}; i < grid.height() + 2; ++i)
+            {
+                // column
+                for (int j {0}; j < grid.width() + 2; ++j)
+                {
+                    text += (i == robot.x && j == robot.y ? 'R' : tileChar(getCode(i, j)));
+                    text += ' ';
+
+                    // start a new line at the final column number
+                    if (j == grid.width() + 1)
+                    {
+                        text += '\n';
+                    }
+                }
+            }
+            out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        }
+};
+
+#endif
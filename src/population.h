@@ -0,0 +1,377 @@
+#ifndef POPULATION_H
+#define POPULATION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "genome.h"
+#include "map.h"
+#include "rng.h"
+#include "robot.h"
+
+// half of the robots are kept as parents and the children are bred from pairs of them,
+// so anything smaller than this would leave no parents after the first generation
+constexpr std::size_t MIN_POPULATION_SIZE {4};
+
+// every pair of parents has two children, so only a multiple of 4 comes back to the same
+// size after culling and breeding, 6 robots keep 3 parents, breed 2 children and are 5
+inline bool isValidPopulationSize(std::size_t size)
+{
+    return size >= MIN_POPULATION_SIZE && size % 4 == 0;
+}
+
+// how a robot's first evaluation trial started, enough to simulate it again step by step
+// only known once the robot has been scored by this run, see recorded
+struct LifeStart
+{
+    Coordinates spawn {};
+    std::uint32_t seed {};
+    bool recorded {false};
+};
+
+// the whole population stored as one array per field instead of one array of robots
+// so sorting, culling and breeding only touch the fields they need
+//
+// there are two sets of arrays, the current generation and a spare one that reorder()
+// gathers into before the two are swapped, both are sized up front and only ever grow,
+// so once the population is full a generation turnover never allocates
+template <typename Grid, std::size_t GeneCount>
+class Population
+{
+    public:
+        using RobotType = Robot<Grid, GeneCount>;
+
+    private:
+        struct Fields
+        {
+            std::vector<Genome<GeneCount>> genomes {};
+            // layouts are shared and never change, a robot only needs to know which one it is on
+            std::vector<std::shared_ptr<const BatteryLayout<Grid>>> layouts {};
+            std::vector<Coordinates> coordinates {};
+            std::vector<int> power {};
+            std::vector<int> turnsSurvived {};
+            std::vector<int> powerHarvested {};
+            // power harvested over every evaluation trial, the mean is what selection uses
+            std::vector<double> fitness {};
+            std::vector<int> fitnessMin {};
+            std::vector<double> fitnessVariance {};
+            std::vector<LifeStart> lifeStarts {};
+
+            void resize(std::size_t size)
+            {
+                genomes.resize(size);
+                layouts.resize(size);
+                coordinates.resize(size);
+                power.resize(size);
+                turnsSurvived.resize(size);
+                powerHarvested.resize(size);
+                fitness.resize(size);
+                fitnessMin.resize(size);
+                fitnessVariance.resize(size);
+                lifeStarts.resize(size);
+            }
+        };
+
+        Fields m_current {};
+        Fields m_spare {};
+        // robots in use, the arrays may be longer
+        std::size_t m_size {0};
+        // scratch for sortByFitness()
+        std::vector<std::size_t> m_order {};
+        // where layouts are handed back to, see returnLayoutsTo()
+        LayoutSource<Grid>* m_layoutSource {nullptr};
+
+        // drop the robots' hold on their layouts so the layout source can reuse them
+        void releaseLayouts(Fields& fields, std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i {begin}; i < end; ++i)
+            {
+                if (m_layoutSource)
+                    m_layoutSource->release(fields.layouts[i]);
+                else
+                    fields.layouts[i].reset();
+            }
+        }
+    public:
+        Population() = default;
+
+        // create a population of random robots
+        Population(std::size_t size, LayoutSource<Grid>& layouts, Rng& rng)
+        {
+            reserve(size);
+            for (std::size_t i {0}; i < size; ++i)
+            {
+                Genome<GeneCount>& genome {m_current.genomes[addRobot(layouts.nextLayout(rng), rng)]};
+                genome = Genome<GeneCount>::random(rng);
+            }
+        }
+
+        // hand the layouts of dropped robots back to layouts, so new robots get them
+        // regenerated in place instead of allocating, without this they are freed
+        // layouts has to outlive the population
+        void returnLayoutsTo(LayoutSource<Grid>& layouts) {m_layoutSource = &layouts;}
+
+        // make room for size robots in both generations
+        void reserve(std::size_t size)
+        {
+            if (size <= capacity())
+                return;
+
+            m_current.resize(size);
+            m_spare.resize(size);
+        }
+
+        std::size_t size() const {return m_size;}
+        std::size_t capacity() const {return m_current.genomes.size();}
+
+        // add a robot on the given layout and return its index
+        // its genome is left as it was for the caller to overwrite
+        std::size_t addRobot(std::shared_ptr<const BatteryLayout<Grid>> layout, Rng& rng)
+        {
+            Coordinates spawn {layout->spawnRobot(rng)};
+            return addRobot(std::move(layout), spawn);
+        }
+
+        // add a robot at a known spot, used when loading a saved population
+        std::size_t addRobot(std::shared_ptr<const BatteryLayout<Grid>> layout, Coordinates coordinates)
+        {
+            if (m_size == capacity())
+                reserve(m_size > 0 ? m_size * 2 : 1);
+
+            std::size_t i {m_size++};
+            m_current.coordinates[i] = coordinates;
+            m_current.layouts[i] = std::move(layout);
+            m_current.power[i] = STARTING_POWER;
+            m_current.turnsSurvived[i] = 0;
+            m_current.powerHarvested[i] = 0;
+            m_current.fitness[i] = 0.0;
+            m_current.fitnessMin[i] = 0;
+            m_current.fitnessVariance[i] = 0.0;
+            m_current.lifeStarts[i] = LifeStart {coordinates, 0, false};
+            return i;
+        }
+
+        // getter functions
+        Genome<GeneCount>& getGenome(std::size_t i) {return m_current.genomes[i];}
+        const Genome<GeneCount>& getGenome(std::size_t i) const {return m_current.genomes[i];}
+        int getPower(std::size_t i) const {return m_current.power[i];}
+        int getTurnsSurvived(std::size_t i) const {return m_current.turnsSurvived[i];}
+        int getPowerHarvested(std::size_t i) const {return m_current.powerHarvested[i];}
+        Coordinates getCoordinates(std::size_t i) const {return m_current.coordinates[i];}
+        const BatteryLayout<Grid>& getLayout(std::size_t i) const {return *m_current.layouts[i];}
+        double getFitness(std::size_t i) const {return m_current.fitness[i];}
+        int getFitnessMin(std::size_t i) const {return m_current.fitnessMin[i];}
+        double getFitnessVariance(std::size_t i) const {return m_current.fitnessVariance[i];}
+        const LifeStart& getLifeStart(std::size_t i) const {return m_current.lifeStarts[i];}
+        // one entry per robot, plus unused ones past size()
+        const std::vector<double>& getFitness() const {return m_current.fitness;}
+
+        // a robot ready to be simulated on a fresh copy of its layout from where it spawned
+        RobotType getRobot(std::size_t i) const {return RobotType {m_current.genomes[i], *m_current.layouts[i], m_current.coordinates[i]};}
+
+        // write back what happened to a robot after it was simulated
+        void storeRobot(std::size_t i, const RobotType& robot)
+        {
+            storeResult(i, robot.getCoordinates(), robot.getPower(), robot.getTurnsSurvived(), robot.getPowerHarvested());
+        }
+
+        void storeResult(std::size_t i, Coordinates coordinates, int power, int turnsSurvived, int powerHarvested)
+        {
+            m_current.coordinates[i] = coordinates;
+            m_current.power[i] = power;
+            m_current.turnsSurvived[i] = turnsSurvived;
+            m_current.powerHarvested[i] = powerHarvested;
+        }
+
+        // the seed of the random state the robot's first trial ran with
+        void storeLifeSeed(std::size_t i, std::uint32_t seed)
+        {
+            m_current.lifeStarts[i].seed = seed;
+            m_current.lifeStarts[i].recorded = true;
+        }
+
+        void storeFitness(std::size_t i, double mean, int min, double variance)
+        {
+            m_current.fitness[i] = mean;
+            m_current.fitnessMin[i] = min;
+            m_current.fitnessVariance[i] = variance;
+        }
+
+        // rearrange the robots so that the robot at order[i] ends up at index i
+        // order may be shorter than size() and may name a robot more than once, robots it
+        // leaves out are dropped and robots it repeats are copied
+        void reorder(const std::vector<std::size_t>& order)
+        {
+            for (std::size_t i {0}; i < order.size(); ++i)
+            {
+                std::size_t from {order[i]};
+                m_spare.genomes[i] = m_current.genomes[from];
+                m_spare.layouts[i] = m_current.layouts[from];
+                m_spare.coordinates[i] = m_current.coordinates[from];
+                m_spare.power[i] = m_current.power[from];
+                m_spare.turnsSurvived[i] = m_current.turnsSurvived[from];
+                m_spare.powerHarvested[i] = m_current.powerHarvested[from];
+                m_spare.fitness[i] = m_current.fitness[from];
+                m_spare.fitnessMin[i] = m_current.fitnessMin[from];
+                m_spare.fitnessVariance[i] = m_current.fitnessVariance[from];
+                m_spare.lifeStarts[i] = m_current.lifeStarts[from];
+            }
+
+            std::swap(m_current, m_spare);
+            std::size_t oldSize {m_size};
+            m_size = order.size();
+            releaseLayouts(m_spare, 0, oldSize);
+            releaseLayouts(m_current, m_size, oldSize);
+        }
+
+        // sort the robots' fitness from greatest to least
+        // only the indices are sorted, then every field is moved into place once
+        void sortByFitness()
+        {
+            m_order.resize(m_size);
+            for (std::size_t i {0}; i < m_size; ++i)
+            {
+                m_order[i] = i;
+            }
+
+            const std::vector<double>& fitness {m_current.fitness};
+            // ties go to the lower index, the same order truncation selection gives
+            std::sort(m_order.begin(), m_order.end(), [&](std::size_t a, std::size_t b) {
+                return fitness[a] > fitness[b] || (fitness[a] == fitness[b] && a < b);
+            });
+
+            reorder(m_order);
+        }
+
+        // keep only the first size robots
+        void truncate(std::size_t size)
+        {
+            if (size >= m_size)
+                return;
+
+            releaseLayouts(m_current, size, m_size);
+            m_size = size;
+        }
+};
+
+// the part of a population that lives from one generation to the next, for runs that
+// only put a robot on a layout while it is being scored, with the same double buffering
+// as Population so a generation turnover never allocates once it is full
+// any genome works, the packed Genome for --chunk-size and RuleGenome for --rules
+//
+// scores of different robots can be stored from different threads at the same time
+template <typename GenomeType>
+class GenomePopulation
+{
+    private:
+        struct Fields
+        {
+            std::vector<GenomeType> genomes {};
+            std::vector<double> fitness {};
+            std::vector<int> fitnessMin {};
+            std::vector<double> fitnessVariance {};
+            // a byte per robot instead of std::vector<bool>, so threads never share one
+            std::vector<std::uint8_t> scored {};
+
+            void resize(std::size_t size)
+            {
+                genomes.resize(size);
+                fitness.resize(size);
+                fitnessMin.resize(size);
+                fitnessVariance.resize(size);
+                scored.resize(size);
+            }
+        };
+
+        Fields m_current {};
+        Fields m_spare {};
+        std::size_t m_size {0};
+    public:
+        GenomePopulation() = default;
+
+        // size genomes made by makeGenome()
+        template <typename MakeGenome>
+        GenomePopulation(std::size_t size, MakeGenome makeGenome)
+        {
+            reserve(size);
+            for (std::size_t i {0}; i < size; ++i)
+            {
+                m_current.genomes[addRobot()] = makeGenome();
+            }
+        }
+
+        void reserve(std::size_t size)
+        {
+            if (size <= capacity())
+                return;
+
+            m_current.resize(size);
+            m_spare.resize(size);
+        }
+
+        std::size_t size() const {return m_size;}
+        std::size_t capacity() const {return m_current.genomes.size();}
+
+        // the bytes kept between generations, both buffers included, not counting
+        // anything a genome keeps on the heap
+        std::size_t residentBytes() const
+        {
+            return capacity() * 2 * (sizeof(GenomeType) + sizeof(double) + sizeof(int) + sizeof(double) + sizeof(std::uint8_t));
+        }
+
+        // add an unscored robot and return its index, its genome is left for the caller
+        std::size_t addRobot()
+        {
+            if (m_size == capacity())
+                reserve(m_size > 0 ? m_size * 2 : 1);
+
+            std::size_t i {m_size++};
+            m_current.fitness[i] = 0.0;
+            m_current.fitnessMin[i] = 0;
+            m_current.fitnessVariance[i] = 0.0;
+            m_current.scored[i] = 0;
+            return i;
+        }
+
+        GenomeType& getGenome(std::size_t i) {return m_current.genomes[i];}
+        const GenomeType& getGenome(std::size_t i) const {return m_current.genomes[i];}
+        double getFitness(std::size_t i) const {return m_current.fitness[i];}
+        int getFitnessMin(std::size_t i) const {return m_current.fitnessMin[i];}
+        double getFitnessVariance(std::size_t i) const {return m_current.fitnessVariance[i];}
+        bool isScored(std::size_t i) const {return m_current.scored[i] != 0;}
+        // one entry per robot, plus unused ones past size()
+        const std::vector<double>& getFitness() const {return m_current.fitness;}
+
+        void storeFitness(std::size_t i, double mean, int min, double variance)
+        {
+            m_current.fitness[i] = mean;
+            m_current.fitnessMin[i] = min;
+            m_current.fitnessVariance[i] = variance;
+            m_current.scored[i] = 1;
+        }
+
+        // the same as Population::reorder()
+        void reorder(const std::vector<std::size_t>& order)
+        {
+            for (std::size_t i {0}; i < order.size(); ++i)
+            {
+                std::size_t from {order[i]};
+                m_spare.genomes[i] = m_current.genomes[from];
+                m_spare.fitness[i] = m_current.fitness[from];
+                m_spare.fitnessMin[i] = m_current.fitnessMin[from];
+                m_spare.fitnessVariance[i] = m_current.fitnessVariance[from];
+                m_spare.scored[i] = m_current.scored[from];
+            }
+
+            std::swap(m_current, m_spare);
+            m_size = order.size();
+        }
+
+        void truncate(std::size_t size) {m_size = std::min(size, m_size);}
+};
+
+#endif
@@ -0,0 +1,578 @@
+#ifndef PROCESS_EVALUATOR_H
+#define PROCESS_EVALUATOR_H
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "counter_rng.h"
+#include "evaluation_arena.h"
+#include "evaluation_set.h"
+#include "fitness_cache.h"
+#include "genome.h"
+#include "map.h"
+#include "population.h"
+#include "stats.h"
+
+// evaluation in worker processes instead of worker threads
+// this process keeps selection and breeding, every generation it cuts the robots that
+// still need a score into batches and hands them to workers over unix domain sockets
+//
+// workers are forked from a spawner process, which is forked from this one by start()
+// before any thread is running, so they already have the grid, the shared layouts and
+// the fixed evaluation set, and only the genome, layout seed and spawn spot of each
+// robot is sent over
+// the spawner never starts a thread, so it can fork a new worker in the middle of a run
+// where this process can't, a lock held by a thread pool or telemetry thread at the
+// moment of a fork would stay locked forever in the child
+//
+// every robot is sent with its life seed, looked up by its index like the worker threads
+// do, so the scores are the same as with threads and do not depend on how the robots were
+// cut into batches, which worker ran a batch or how many workers there are, and a worker
+// that dies part way can be replaced and its batch run again with the same result
+
+struct ProcessSettings
+{
+    std::size_t workerCount {2};
+    // robots sent to a worker at a time
+    std::size_t batchSize {32};
+    // pin worker i to cpu i, so the operating system can keep it next to its memory
+    bool pinWorkers {false};
+    bool batched {false};
+    std::size_t trials {1};
+    // a batch that kills this many workers is given up on
+    std::size_t maxAttempts {3};
+};
+
+template <typename Grid, std::size_t GeneCount>
+class ProcessEvaluator
+{
+    public:
+        using PopulationType = Population<Grid, GeneCount>;
+    private:
+        // one robot to score, sent to a worker
+        struct WorkItem
+        {
+            std::array<std::uint64_t, Genome<GeneCount>::WORD_COUNT> words;
+            std::uint32_t layoutSeed;
+            std::uint32_t lifeSeed;
+            Coordinates spawn;
+        };
+
+        // sent before the robots of a batch and before the results coming back
+        struct BatchHeader
+        {
+            std::uint64_t batchId;
+            std::uint32_t robotCount;
+            SimulationCounters counters;
+        };
+
+        struct Batch
+        {
+            std::uint64_t id {};
+            // the robots in the population, in the order they are sent
+            std::vector<std::size_t> robots {};
+            std::size_t attempts {};
+        };
+
+        // what this process asks the spawner for
+        enum class SpawnCommand : std::uint32_t
+        {
+            Start,
+            Stop,
+        };
+
+        struct SpawnRequest
+        {
+            SpawnCommand command;
+            std::uint32_t index;
+            pid_t pid;
+        };
+
+        // the answer to a Start, which comes with the worker's socket unless pid is -1
+        struct SpawnReply
+        {
+            pid_t pid;
+        };
+
+        struct Worker
+        {
+            pid_t pid {-1};
+            int socket {-1};
+            // the batch it is working on, -1 when it is idle
+            std::ptrdiff_t batch {-1};
+        };
+
+        ProcessSettings m_settings {};
+        const Grid& m_grid;
+        LayoutSource<Grid>& m_layouts;
+        const EvaluationSet<Grid>* m_fixedSet {nullptr};
+
+        pid_t m_spawnerPid {-1};
+        int m_spawner {-1};
+        std::vector<Worker> m_workers {};
+        std::vector<Batch> m_batches {};
+        std::deque<std::size_t> m_queue {};
+        std::vector<WorkItem> m_items {};
+        std::vector<CachedFitness> m_results {};
+        SimulationCounters m_counters {};
+        std::size_t m_restarts {};
+
+        // whole reads and writes on a stream socket, false if the other side is gone
+        static bool sendAll(int socket, const void* data, std::size_t size)
+        {
+            const char* bytes {static_cast<const char*>(data)};
+            while (size > 0)
+            {
+                // a dead worker must not take this process down with SIGPIPE
+                ssize_t sent {::send(socket, bytes, size, MSG_NOSIGNAL)};
+                if (sent < 0 && errno == EINTR)
+                    continue;
+                if (sent <= 0)
+                    return false;
+
+                bytes += sent;
+                size -= static_cast<std::size_t>(sent);
+            }
+            return true;
+        }
+
+        static bool receiveAll(int socket, void* data, std::size_t size)
+        {
+            char* bytes {static_cast<char*>(data)};
+            while (size > 0)
+            {
+                ssize_t received {::recv(socket, bytes, size, 0)};
+                if (received < 0 && errno == EINTR)
+                    continue;
+                if (received <= 0)
+                    return false;
+
+                bytes += received;
+                size -= static_cast<std::size_t>(received);
+            }
+            return true;
+        }
+
+        // one message between this process and the spawner, with a socket passed along
+        // when socket is not -1
+        template <typename Message>
+        static bool sendMessage(int channel, const Message& message, int socket = -1)
+        {
+            iovec part {const_cast<Message*>(&message), sizeof(message)};
+            msghdr header {};
+            header.msg_iov = &part;
+            header.msg_iovlen = 1;
+
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] {};
+            if (socket >= 0)
+            {
+                header.msg_control = control;
+                header.msg_controllen = sizeof(control);
+                cmsghdr* rights {CMSG_FIRSTHDR(&header)};
+                rights->cmsg_level = SOL_SOCKET;
+                rights->cmsg_type = SCM_RIGHTS;
+                rights->cmsg_len = CMSG_LEN(sizeof(int));
+                std::memcpy(CMSG_DATA(rights), &socket, sizeof(int));
+            }
+
+            ssize_t sent {};
+            do
+            {
+                sent = ::sendmsg(channel, &header, MSG_NOSIGNAL);
+            } while (sent < 0 && errno == EINTR);
+            return sent == static_cast<ssize_t>(sizeof(message));
+        }
+
+        // socket is set to the one that came along, or -1
+        template <typename Message>
+        static bool receiveMessage(int channel, Message& message, int& socket)
+        {
+            iovec part {&message, sizeof(message)};
+            msghdr header {};
+            header.msg_iov = &part;
+            header.msg_iovlen = 1;
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] {};
+            header.msg_control = control;
+            header.msg_controllen = sizeof(control);
+
+            ssize_t received {};
+            do
+            {
+                received = ::recvmsg(channel, &header, 0);
+            } while (received < 0 && errno == EINTR);
+
+            socket = -1;
+            cmsghdr* rights {CMSG_FIRSTHDR(&header)};
+            if (rights && rights->cmsg_level == SOL_SOCKET && rights->cmsg_type == SCM_RIGHTS)
+                std::memcpy(&socket, CMSG_DATA(rights), sizeof(int));
+            return received == static_cast<ssize_t>(sizeof(message));
+        }
+
+        // what a worker process does until this process closes its socket
+        [[noreturn]] void workerMain(int socket, std::size_t index)
+        {
+#if defined(__linux__)
+            if (m_settings.pinWorkers)
+            {
+                long cpuCount {sysconf(_SC_NPROCESSORS_ONLN)};
+                cpu_set_t cpus;
+                CPU_ZERO(&cpus);
+                CPU_SET(static_cast<int>(index % static_cast<std::size_t>(cpuCount > 0 ? cpuCount : 1)), &cpus);
+                sched_setaffinity(0, sizeof(cpus), &cpus);
+            }
+#else
+            static_cast<void>(index);
+#endif
+
+            EvaluationArena<Grid, GeneCount> arena {m_grid};
+            PopulationType robots {};
+            robots.returnLayoutsTo(m_layouts);
+            std::vector<WorkItem> items {};
+            std::vector<std::uint32_t> lifeSeeds {};
+            std::vector<CachedFitness> results {};
+
+            BatchHeader header {};
+            while (receiveAll(socket, &header, sizeof(header)))
+            {
+                items.resize(header.robotCount);
+                if (!receiveAll(socket, items.data(), items.size() * sizeof(WorkItem)))
+                    break;
+
+                robots.truncate(0);
+                lifeSeeds.clear();
+                for (const WorkItem& item : items)
+                {
+                    std::size_t robot {robots.addRobot(m_layouts.layoutForSeed(item.layoutSeed), item.spawn)};
+                    robots.getGenome(robot) = Genome<GeneCount>::fromWords(item.words.data());
+                    lifeSeeds.push_back(item.lifeSeed);
+                }
+
+                if (m_settings.batched)
+                    arena.evaluateRangeBatched(robots, 0, robots.size(), m_layouts, m_settings.trials, lifeSeeds.data(), m_fixedSet);
+                else
+                    arena.evaluateRange(robots, 0, robots.size(), m_layouts, m_settings.trials, lifeSeeds.data(), m_fixedSet);
+
+                results.resize(robots.size());
+                for (std::size_t i {0}; i < robots.size(); ++i)
+                {
+                    results[i] = CachedFitness {robots.getFitness(i), robots.getFitnessMin(i), robots.getFitnessVariance(i),
+                                                robots.getCoordinates(i), robots.getPower(i), robots.getTurnsSurvived(i), robots.getPowerHarvested(i),
+                                                robots.getLifeStart(i).seed};
+                }
+
+                header.counters = SimulationCounters {};
+                arena.takeCounters(header.counters);
+                if (!sendAll(socket, &header, sizeof(header)) || !sendAll(socket, results.data(), results.size() * sizeof(CachedFitness)))
+                    break;
+            }
+
+            // skip the exit handlers and stdio buffers, they belong to the parent
+            _exit(0);
+        }
+
+        // what the spawner does until this process closes its end of channel
+        // it only ever runs on one thread, so its children can do anything a process can
+        [[noreturn]] void spawnerMain(int channel)
+        {
+            SpawnRequest request {};
+            int unused {-1};
+            while (receiveMessage(channel, request, unused))
+            {
+                if (request.command == SpawnCommand::Start)
+                {
+                    int socket {-1};
+                    pid_t pid {forkWorker(channel, request.index, socket)};
+                    bool sent {sendMessage(channel, SpawnReply {pid}, socket)};
+                    if (socket >= 0)
+                        ::close(socket);
+                    if (!sent)
+                        break;
+                }
+                else
+                {
+                    reapWorker(request.pid);
+                }
+            }
+
+            // the workers left see this process's sockets close and exit by themselves
+            _exit(0);
+        }
+
+        // fork worker index from the spawner, -1 if the operating system won't give us a process
+        // socket is set to this process's end of the worker's socket
+        pid_t forkWorker(int channel, std::size_t index, int& socket)
+        {
+            int sockets[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+                return -1;
+
+            pid_t pid {::fork()};
+            if (pid < 0)
+            {
+                ::close(sockets[0]);
+                ::close(sockets[1]);
+                return -1;
+            }
+
+            if (pid == 0)
+            {
+                ::close(channel);
+                ::close(sockets[0]);
+                workerMain(sockets[1], index);
+            }
+
+            ::close(sockets[1]);
+            socket = sockets[0];
+            return pid;
+        }
+
+        // it exits by itself once its socket is closed, unless it is stuck
+        static void reapWorker(pid_t pid)
+        {
+            int status {};
+            if (::waitpid(pid, &status, WNOHANG) == 0)
+            {
+                ::kill(pid, SIGKILL);
+                ::waitpid(pid, &status, 0);
+            }
+        }
+
+        // have the spawner fork worker i, false if it couldn't
+        bool startWorker(std::size_t i)
+        {
+            SpawnReply reply {-1};
+            int socket {-1};
+            SpawnRequest request {SpawnCommand::Start, static_cast<std::uint32_t>(i), -1};
+            if (!sendMessage(m_spawner, request) || !receiveMessage(m_spawner, reply, socket) || reply.pid < 0 || socket < 0)
+            {
+                if (socket >= 0)
+                    ::close(socket);
+                return false;
+            }
+
+            m_workers[i] = Worker {reply.pid, socket, -1};
+            return true;
+        }
+
+        void stopWorker(Worker& worker)
+        {
+            if (worker.pid < 0)
+                return;
+
+            ::close(worker.socket);
+            sendMessage(m_spawner, SpawnRequest {SpawnCommand::Stop, 0, worker.pid});
+            worker = Worker {};
+        }
+
+        // put a dead worker's batch back in the queue and start a new worker in its place
+        bool restartWorker(std::size_t i)
+        {
+            Worker& worker {m_workers[i]};
+            std::cerr << "Worker process " << worker.pid << " stopped, restarting it\n";
+
+            if (worker.batch >= 0)
+            {
+                Batch& batch {m_batches[static_cast<std::size_t>(worker.batch)]};
+                if (++batch.attempts >= m_settings.maxAttempts)
+                {
+                    std::cerr << "Batch " << batch.id << " stopped " << batch.attempts << " workers, giving up\n";
+                    return false;
+                }
+                m_queue.push_front(static_cast<std::size_t>(worker.batch));
+            }
+
+            stopWorker(worker);
+            ++m_restarts;
+            return startWorker(i);
+        }
+
+        bool sendBatch(std::size_t workerIndex, std::size_t batchIndex, const PopulationType& robots, const LifeSeeds& seeds)
+        {
+            Worker& worker {m_workers[workerIndex]};
+            const Batch& batch {m_batches[batchIndex]};
+            worker.batch = static_cast<std::ptrdiff_t>(batchIndex);
+
+            m_items.resize(batch.robots.size());
+            for (std::size_t j {0}; j < batch.robots.size(); ++j)
+            {
+                std::size_t robot {batch.robots[j]};
+                m_items[j] = WorkItem {robots.getGenome(robot).getWords(), robots.getLayout(robot).getSeed(), m_fixedSet ? 0 : seeds.at(robot), robots.getCoordinates(robot)};
+            }
+
+            BatchHeader header {batch.id, static_cast<std::uint32_t>(batch.robots.size()), SimulationCounters {}};
+            return sendAll(worker.socket, &header, sizeof(header)) && sendAll(worker.socket, m_items.data(), m_items.size() * sizeof(WorkItem));
+        }
+
+        bool receiveBatch(std::size_t workerIndex, PopulationType& robots)
+        {
+            Worker& worker {m_workers[workerIndex]};
+            const Batch& batch {m_batches[static_cast<std::size_t>(worker.batch)]};
+
+            BatchHeader header {};
+            if (!receiveAll(worker.socket, &header, sizeof(header)) || header.batchId != batch.id || header.robotCount != batch.robots.size())
+                return false;
+
+            m_results.resize(batch.robots.size());
+            if (!receiveAll(worker.socket, m_results.data(), m_results.size() * sizeof(CachedFitness)))
+                return false;
+
+            for (std::size_t j {0}; j < batch.robots.size(); ++j)
+            {
+                const CachedFitness& result {m_results[j]};
+                robots.storeResult(batch.robots[j], result.coordinates, result.power, result.turnsSurvived, result.powerHarvested);
+                robots.storeFitness(batch.robots[j], result.mean, result.min, result.variance);
+                robots.storeLifeSeed(batch.robots[j], result.lifeSeed);
+            }
+            m_counters += header.counters;
+            worker.batch = -1;
+            return true;
+        }
+    public:
+        ProcessEvaluator(const Grid& grid, LayoutSource<Grid>& layouts, const ProcessSettings& settings, const EvaluationSet<Grid>* fixedSet = nullptr)
+        : m_settings {settings}
+        , m_grid {grid}
+        , m_layouts {layouts}
+        , m_fixedSet {fixedSet}
+        {
+            if (m_settings.batchSize == 0)
+                m_settings.batchSize = 1;
+            m_workers.resize(m_settings.workerCount > 0 ? m_settings.workerCount : 1);
+        }
+
+        ProcessEvaluator(const ProcessEvaluator&) = delete;
+        ProcessEvaluator& operator=(const ProcessEvaluator&) = delete;
+
+        ~ProcessEvaluator()
+        {
+            for (Worker& worker : m_workers)
+            {
+                stopWorker(worker);
+            }
+
+            if (m_spawnerPid >= 0)
+            {
+                ::close(m_spawner);
+                int status {};
+                ::waitpid(m_spawnerPid, &status, 0);
+            }
+        }
+
+        // fork the spawner and have it fork every worker, check this before evaluating
+        // this has to be called before this process starts any thread
+        bool start()
+        {
+            int sockets[2];
+            if (::socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sockets) != 0)
+                return false;
+
+            pid_t pid {::fork()};
+            if (pid < 0)
+            {
+                ::close(sockets[0]);
+                ::close(sockets[1]);
+                return false;
+            }
+
+            if (pid == 0)
+            {
+                ::close(sockets[0]);
+                spawnerMain(sockets[1]);
+            }
+
+            ::close(sockets[1]);
+            m_spawnerPid = pid;
+            m_spawner = sockets[0];
+
+            for (std::size_t i {0}; i < m_workers.size(); ++i)
+            {
+                if (!startWorker(i))
+                    return false;
+            }
+            return true;
+        }
+
+        // score every robot that is not out of power yet
+        // returns false if the workers could not be kept running
+        bool evaluate(PopulationType& robots, const LifeSeeds& seeds)
+        {
+            m_batches.clear();
+            m_queue.clear();
+            for (std::size_t i {0}; i < robots.size(); ++i)
+            {
+                if (robots.getPower(i) == 0)
+                    continue;
+
+                if (m_batches.empty() || m_batches.back().robots.size() == m_settings.batchSize)
+                {
+                    m_batches.push_back(Batch {m_batches.size(), {}, 0});
+                    m_queue.push_back(m_batches.size() - 1);
+                }
+                m_batches.back().robots.push_back(i);
+            }
+
+            std::size_t remaining {m_batches.size()};
+            std::vector<pollfd> polls(m_workers.size());
+            while (remaining > 0)
+            {
+                // keep every idle worker busy
+                for (std::size_t i {0}; i < m_workers.size() && !m_queue.empty(); ++i)
+                {
+                    if (m_workers[i].batch >= 0)
+                        continue;
+
+                    std::size_t batch {m_queue.front()};
+                    m_queue.pop_front();
+                    if (!sendBatch(i, batch, robots, seeds) && !restartWorker(i))
+                        return false;
+                }
+
+                for (std::size_t i {0}; i < m_workers.size(); ++i)
+                {
+                    polls[i] = pollfd {m_workers[i].socket, POLLIN, 0};
+                }
+                if (::poll(polls.data(), static_cast<nfds_t>(polls.size()), -1) < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    return false;
+                }
+
+                for (std::size_t i {0}; i < m_workers.size(); ++i)
+                {
+                    if (polls[i].revents == 0)
+                        continue;
+
+                    if (m_workers[i].batch >= 0 && (polls[i].revents & POLLIN) && receiveBatch(i, robots))
+                        --remaining;
+                    else if (!restartWorker(i))
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        // add the counters the workers sent back since the last call to total
+        void takeCounters(SimulationCounters& total)
+        {
+            total += m_counters;
+            m_counters = SimulationCounters {};
+        }
+
+        std::size_t getRestarts() const {return m_restarts;}
+};
+
+#endif
@@ -0,0 +1,222 @@
+// replays robot lives recorded with --record
+// every life is rebuilt from its layout seed, spawn spot and recorded steps, so a replay
+// shows exactly what the robot saw without running the genetic algorithm again
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <exception>
+
+#include "genome.h"
+#include "grid.h"
+#include "map.h"
+#include "trajectory.h"
+
+struct ReplayOptions
+{
+    std::string path {};
+
+    // only this life, counted from 0 in file order, every life when not given
+    bool singleLife {false};
+    std::size_t life {};
+
+    // print the map after every step instead of one line per life
+    bool frames {false};
+
+    // print the genes of every life shown
+    bool genes {false};
+
+    // write every step as a CSV row here instead
+    std::string exportPath {};
+};
+
+// Function Prototypes
+bool parseOptions(int argc, char* argv[], ReplayOptions& options);
+template <std::size_t GeneCount>
+int replay(const ReplayOptions& options, TrajectoryReader& reader);
+const char* directionName(int direction);
+
+int main(int argc, char* argv[])
+{
+    ReplayOptions options {};
+
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cerr << "Usage: " << argv[0] << " <file> [--life <index>] [--frames] [--genes] [--export <file.csv>]\n";
+        return 1;
+    }
+
+    TrajectoryReader reader {};
+    if (!reader.open(options.path))
+    {
+        std::cerr << reader.getError() << '\n';
+        return 1;
+    }
+
+    switch (reader.header().geneCount)
+    {
+    case 8:
+        return replay<8>(options, reader);
+    case 16:
+        return replay<16>(options, reader);
+    case 32:
+        return replay<32>(options, reader);
+    default:
+        std::cerr << options.path << " has " << reader.header().geneCount << " genes per robot, this build replays 8, 16 or 32\n";
+        return 1;
+    }
+}
+
+// fills in options from the command line, returns false if something is wrong
+bool parseOptions(int argc, char* argv[], ReplayOptions& options)
+{
+    try
+    {
+        for (int i {1}; i < argc; ++i)
+        {
+            std::string argument {argv[i]};
+
+            if (argument == "--life" && i + 1 < argc)
+            {
+                options.singleLife = true;
+                options.life = static_cast<std::size_t>(std::stoul(argv[++i]));
+            }
+            else if (argument == "--frames")
+            {
+                options.frames = true;
+            }
+            else if (argument == "--genes")
+            {
+                options.genes = true;
+            }
+            else if (argument == "--export" && i + 1 < argc)
+            {
+                options.exportPath = argv[++i];
+            }
+            else if (options.path.empty() && argument.rfind("--", 0) != 0)
+            {
+                options.path = argument;
+            }
+            else
+            {
+                return false;
+            }
+        }
+    }
+    catch (const std::exception&)
+    {
+        // not a number
+        return false;
+    }
+
+    return !options.path.empty();
+}
+
+// walks every chosen life step by step on a map rebuilt from its seed
+// the replayed score has to match the recorded one, otherwise the file does not belong
+// to this build's layouts and the life is reported as a mismatch
+template <std::size_t GeneCount>
+int replay(const ReplayOptions& options, TrajectoryReader& reader)
+{
+    const TrajectoryFileHeader& header {reader.header()};
+    DynamicGrid grid {header.width, header.height, header.batteryPercent};
+    BatteryLayout<DynamicGrid> layout {grid};
+
+    std::ofstream csv {};
+    if (!options.exportPath.empty())
+    {
+        csv.open(options.exportPath);
+        if (!csv)
+        {
+            std::cerr << "Could not open " << options.exportPath << '\n';
+            return 1;
+        }
+        csv << "life,generation,robot,step,direction,random,x,y,power,power_harvested\n";
+    }
+
+    int mismatches {0};
+    Trajectory<GeneCount> trajectory {};
+    for (std::size_t life {0}; reader.next(trajectory); ++life)
+    {
+        if (options.singleLife && life != options.life)
+            continue;
+
+        const TrajectoryRecord& record {trajectory.record};
+        layout.generate(record.layoutSeed);
+        Map<DynamicGrid> map {layout};
+
+        int x {record.spawnX};
+        int y {record.spawnY};
+        int power {STARTING_POWER};
+        int turnsSurvived {0};
+        int powerHarvested {0};
+
+        std::cout << "Life " << life << ": Generation " << record.generation << ", Robot " << record.robot << ", Fitness: " << record.fitness
+                  << ", Power Harvested: " << record.powerHarvested << ", Turns Survived: " << record.turnsSurvived << ", Steps: " << record.stepCount << '\n';
+        if (options.genes)
+            trajectory.genome.displayGenes(std::cout);
+        if (options.frames)
+        {
+            std::cout << "Step 0: Spawned\n";
+            map.displayMap(Coordinates {x, y}, std::cout);
+        }
+
+        for (std::size_t step {0}; step < trajectory.steps.size(); ++step)
+        {
+            int direction {trajectory.steps.direction(step)};
+            switch (direction)
+            {
+            case North:
+                map.moveNorth(x, y, power, turnsSurvived, powerHarvested);
+                break;
+            case South:
+                map.moveSouth(x, y, power, turnsSurvived, powerHarvested);
+                break;
+            case East:
+                map.moveEast(x, y, power, turnsSurvived, powerHarvested);
+                break;
+            default:
+                map.moveWest(x, y, power, turnsSurvived, powerHarvested);
+                break;
+            }
+
+            if (options.frames)
+            {
+                std::cout << "Step " << step + 1 << ": " << directionName(direction) << (trajectory.steps.isRandom(step) ? " (random)" : "")
+                          << ", Power: " << power << ", Power Harvested: " << powerHarvested << '\n';
+                map.displayMap(Coordinates {x, y}, std::cout);
+            }
+
+            if (csv.is_open())
+            {
+                csv << life << ',' << record.generation << ',' << record.robot << ',' << step + 1 << ',' << directionName(direction) << ','
+                    << (trajectory.steps.isRandom(step) ? 1 : 0) << ',' << x << ',' << y << ',' << power << ',' << powerHarvested << '\n';
+            }
+        }
+
+        if (powerHarvested != record.powerHarvested || turnsSurvived != record.turnsSurvived)
+        {
+            std::cout << "    Mismatch: the replay harvested " << powerHarvested << " power in " << turnsSurvived << " turns\n";
+            ++mismatches;
+        }
+    }
+
+    return mismatches == 0 ? 0 : 1;
+}
+
+const char* directionName(int direction)
+{
+    switch (direction)
+    {
+    case North:
+        return "North";
+    case South:
+        return "South";
+    case East:
+        return "East";
+    default:
+        return "West";
+    }
+}
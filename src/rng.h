@@ -0,0 +1,79 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+// small PCG32 random generator so that every thread, or even every robot, can own its own
+// state instead of sharing the hidden global state behind rand()
+// it is only 16 bytes and cheap to seed, so giving each robot its own stream costs almost nothing
+class Rng
+{
+    private:
+        std::uint64_t m_state {};
+        std::uint64_t m_increment {};
+    public:
+        Rng()
+        : Rng {0}
+        {
+        }
+
+        static constexpr std::uint64_t DEFAULT_STREAM {0xda3e39cb94b95bdbULL};
+
+        // the raw generator, saved in checkpoints so a run can carry on exactly where it stopped
+        struct State
+        {
+            std::uint64_t state;
+            std::uint64_t increment;
+        };
+
+        // generators with the same seed but different streams give unrelated sequences
+        explicit Rng(std::uint64_t seed, std::uint64_t stream = DEFAULT_STREAM)
+        : m_state {0}
+        , m_increment {(stream << 1) | 1}
+        {
+            next();
+            m_state += seed;
+            next();
+        }
+
+        // returns a full 32 bit random value
+        std::uint32_t next()
+        {
+            std::uint64_t oldState {m_state};
+            m_state = oldState * 6364136223846793005ULL + m_increment;
+
+            std::uint32_t xorShifted {static_cast<std::uint32_t>(((oldState >> 18) ^ oldState) >> 27)};
+            std::uint32_t rotation {static_cast<std::uint32_t>(oldState >> 59)};
+            return (xorShifted >> rotation) | (xorShifted << ((32 - rotation) & 31));
+        }
+
+        // returns a number from 0 to bound - 1, used the same way as rand() % bound
+        int nextInt(int bound)
+        {
+            return static_cast<int>(next() % static_cast<std::uint32_t>(bound));
+        }
+
+        // returns a number from 0 up to but not including 1
+        double nextDouble()
+        {
+            return next() * (1.0 / 4294967296.0);
+        }
+
+        // returns a full 32 bit random value, used for deriving seeds
+        std::uint32_t nextSeed()
+        {
+            return next();
+        }
+
+        State getState() const {return State {m_state, m_increment};}
+
+        static Rng fromState(const State& state)
+        {
+            Rng rng {};
+            rng.m_state = state.state;
+            rng.m_increment = state.increment;
+            return rng;
+        }
+};
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef ROBOT_H
+#define ROBOT_H
+
+#include <iostream>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "cycle_tracker.h"
+#include "genome.h"
+#include "map.h"
+#include "rng.h"
+#include "stats.h"
+
+// robots start with power of 5 when they spawn on the map
+constexpr int STARTING_POWER {5};
+
+// one robot living on its map
+// the genome, layout and spawn position are owned by the population, the robot only
+// keeps what changes while it is being simulated so the hot loop works on local state
+template <typename Grid, std::size_t GeneCount>
+class Robot
+{
+    private:
+       const Genome<GeneCount>* m_genome {nullptr};
+       int m_turnsSurvived {}; 
+       int m_power {};
+       Coordinates m_coordinates {};
+       Map<Grid> m_map;
+       // the genes compiled into the action for every possible sensor reading
+       std::array<std::uint8_t, SENSOR_STATES> m_actionTable {};
+       std::size_t m_sensorIndex {};
+       int m_powerHarvested {};
+    public:
+        Robot(const Genome<GeneCount>& genome, const BatteryLayout<Grid>& layout, Coordinates coordinates)
+        : m_genome {&genome}
+        , m_turnsSurvived {0}
+        , m_power {STARTING_POWER}
+        , m_coordinates {coordinates}
+        , m_map {layout}
+        , m_actionTable {genome.compileActionTable()}
+        , m_powerHarvested {0}
+        {
+        }
+
+        // start a new life on another layout, the compiled genes are kept
+        void respawn(const BatteryLayout<Grid>& layout, Coordinates coordinates)
+        {
+            m_map.reset(layout);
+            m_coordinates = coordinates;
+            m_power = STARTING_POWER;
+            m_turnsSurvived = 0;
+            m_powerHarvested = 0;
+        }
+
+        // getter functions
+        int getPower() const {return m_power;}
+        int getTurnsSurvived() const {return m_turnsSurvived;}
+        int getPowerHarvested() const {return m_powerHarvested;}
+        Coordinates getCoordinates() const {return m_coordinates;}
+
+        // * The display functions are just used for testing
+        // display the map for a specific robot
+        void displayMap(std::ostream& out = std::cout) const
+        {
+            m_map.displayMap(m_coordinates, out);
+        }
+
+        // display the genes for a specific robot
+        void displayGenes(std::ostream& out = std::cout) const
+        {
+            m_genome->displayGenes(out);
+        }
+
+        // display the sensor for a specific robot
+        // need to call updateSensor() first to get accurate reading
+        void displaySensor(std::ostream& out = std::cout) const
+        {
+            out << m_sensorIndex / 27 << " " << (m_sensorIndex / 9) % 3 << " " << (m_sensorIndex / 3) % 3 << " " << m_sensorIndex % 3 << " ";
+        }
+
+        // get the sensor's readings in each direction as an index into the action table
+        void updateSensor()
+        {
+            m_sensorIndex = sensorIndex(m_map.getNorthCoordinate(m_coordinates.x, m_coordinates.y),
+                                        m_map.getSouthCoordinate(m_coordinates.x, m_coordinates.y),
+                                        m_map.getEastCoordinate(m_coordinates.x, m_coordinates.y),
+                                        m_map.getWestCoordinate(m_coordinates.x, m_coordinates.y));
+        }
+
+        // move the robot based on what the action code tells it to do
+        void moveRobot(int actionCode, Rng& rng)
+        {
+            m_map.move(actionCode, m_coordinates.x, m_coordinates.y, m_power, m_turnsSurvived, m_powerHarvested, rng);
+        }
+
+        // the action table already holds the first matching gene for every sensor reading,
+        // falling back to the last gene when none of them match
+        // rng is only used when the matched gene asks for a random direction
+        void update(Rng& rng)
+        {
+            moveRobot(m_actionTable[m_sensorIndex], rng);
+        }
+
+        // update() that also tells recorder which way the robot went, a random move is
+        // drawn here instead of in the map so the direction it took can be recorded
+        // the random state ends up the same either way, update() itself is left alone so
+        // the simulation never pays for recording
+        template <typename Recorder>
+        void update(Rng& rng, Recorder& recorder)
+        {
+            int action {m_actionTable[m_sensorIndex]};
+            bool random {action == RandomDir};
+            int direction {random ? rng.nextInt(4) : action};
+            recorder.recordStep(random, direction);
+            moveRobot(direction, rng);
+        }
+
+        // updateSensor() and update() until the robot runs out of power
+        // once the robot is back on a cell it stood on since its last battery or random move
+        // it will go round that same loop until its power runs out, so the rest of the life
+        // is worked out in one go, ending in exactly the state stepping would have
+        void runLife(Rng& rng, CycleTracker<Grid>& cycles)
+        {
+            const Grid& grid {m_map.getGrid()};
+            cycles.reset();
+
+            while (m_power != 0)
+            {
+                std::size_t loopStart {cycles.visit(grid.cellIndex(m_coordinates.x, m_coordinates.y))};
+                if (loopStart != CycleTracker<Grid>::NOT_SEEN)
+                {
+                    std::size_t remaining {static_cast<std::size_t>(m_power)};
+                    std::size_t cell {cycles.cellAfter(loopStart, remaining)};
+                    GA_COUNT(steps, remaining);
+                    GA_COUNT(wallBumps, cycles.wallBumpsAfter(loopStart, remaining));
+
+                    m_coordinates.x = static_cast<int>(cell / static_cast<std::size_t>(grid.rowLength()));
+                    m_coordinates.y = static_cast<int>(cell % static_cast<std::size_t>(grid.rowLength()));
+                    m_turnsSurvived += m_power;
+                    m_power = 0;
+                    return;
+                }
+
+                updateSensor();
+                int action {m_actionTable[m_sensorIndex]};
+                int powerHarvested {m_powerHarvested};
+                moveRobot(action, rng);
+
+                // the map or the random state changed, so the path so far can't repeat
+                if (action == RandomDir || m_powerHarvested != powerHarvested)
+                    cycles.reset();
+            }
+        }
+};
+
+// prints relevant information for a robot
+// ***Mainly for testing***
+template <typename Grid, std::size_t GeneCount>
+std::ostream& operator<<(std::ostream& out, const Robot<Grid, GeneCount>& robot)
+{
+    out << "***Genes***\n";
+    robot.displayGenes(out);
+
+    out << "***Map***\n";
+    robot.displayMap(out);
+
+    out << "***Sensor***\n";
+    robot.displaySensor(out);
+    
+    out << '\n';
+
+    out << "***Turns Survived***\n" << robot.getTurnsSurvived() << '\n';
+    out << "***Power***\n" << robot.getPower() << '\n';
+    out << "***Power Harvested***\n" << robot.getPowerHarvested() << '\n';
+
+    return out;
+}
+
+#endif
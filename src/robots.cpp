@@ -1,694 +1,1167 @@
 // 12/13/2024
 
 #include <iostream>
-#include <array>
 #include <vector>
 #include <ctime>
 #include <cstdlib>
-#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "checkpoint.h"
+#include "chunked_evaluation.h"
+#include "counter_rng.h"
+#include "evaluation_arena.h"
+#include "evaluation_set.h"
+#include "fitness_cache.h"
+#include "genetic_algorithm.h"
+#include "genome.h"
+#include "grid.h"
+#include "island_model.h"
+#include "job_pool.h"
+#include "map.h"
+#include "population.h"
+#include "process_evaluator.h"
+#include "rng.h"
+#include "rule_genome.h"
+#include "rule_robot.h"
+#include "selection.h"
+#include "stats.h"
+#include "steady_state.h"
+#include "sweep.h"
+#include "telemetry.h"
+#include "thread_pool.h"
+#include "trajectory.h"
+
+// everything that can be changed from the command line
+struct Options
+{
+    // seed the randomizer using current time unless a seed is given
+    std::uint32_t seed {static_cast<std::uint32_t>(time(NULL))};
+
+    // 1 thread evaluates the robots one after another like before, 0 uses every core
+    std::size_t threadCount {1};
+
+    // 0 gives every robot its own layout like before, otherwise robots share this many layouts
+    std::size_t sharedLayoutCount {0};
+
+    // simulate several robots at once in vector lanes instead of one at a time
+    bool batched {false};
+
+    // how many layouts each robot is scored on, its fitness is the mean of them
+    std::size_t trials {1};
+
+    // the world and the genome, the original 10x10 grid with 40 percent batteries and
+    // 16 genes are compiled in as constants, anything else uses a grid sized at run time
+    int width {DefaultGrid::width()};
+    int height {DefaultGrid::height()};
+    int batteryPercent {DefaultGrid::batteryPercent()};
+    std::size_t geneCount {DEFAULT_GENE_COUNT};
+
+    // the population of 200 robots, the 100 generations and the 5 percent mutation chance
+    std::size_t populationSize {200};
+    int generations {100};
+    int mutationPercent {DEFAULT_MUTATION_PERCENT};
+
+    // write phase times (and counters in GA_ENABLE_STATS builds) for every generation here
+    std::string statsPath {};
+
+    // more than 1 runs that many populations on their own threads, trading their best
+    // robots every migrationInterval generations
+    std::size_t islandCount {1};
+    int migrationInterval {10};
+    std::size_t migrantCount {5};
+
+    // save the run here every checkpointInterval generations
+    std::string checkpointPath {};
+    int checkpointInterval {10};
+
+    // carry on from a checkpoint exactly where it stopped
+    std::string resumePath {};
+
+    // start a new run with the genomes saved in a checkpoint instead of random ones
+    std::string seedPopulationPath {};
+
+    // where the generation lines go, the console unless a file is given
+    std::string telemetryPath {};
+    TelemetryWriter::Format telemetryFormat {TelemetryWriter::Format::Text};
+    // also write every robot's score every generation
+    bool logRobots {false};
+
+    // score every robot on the same trials made from evaluationSeed instead of its own layouts
+    bool fixedEvaluation {false};
+    std::uint32_t evaluationSeed {};
+
+    // with a fixed evaluation, remember the scores of up to this many genomes
+    std::size_t fitnessCacheSize {0};
+
+    // how the parents of each generation are picked, the best half by default
+    SelectionSettings selection {};
+
+    // more than 0 scores the robots in this many worker processes instead of threads,
+    // handing them processBatchSize robots at a time
+    std::size_t processCount {0};
+    std::size_t processBatchSize {32};
+    bool pinWorkers {false};
+
+    // write every step of the chosen robots' lives here, see GeneticAlgorithmReplay
+    std::string recordPath {};
+    RecordSettings record {};
+
+    // run every configuration and seed in this file as jobs on --threads workers instead,
+    // writing every run's fitness curve to sweepResultsPath
+    std::string sweepPath {};
+    std::string sweepResultsPath {"sweep.csv"};
+
+    // breed and score children continuously on --threads workers instead of a generation
+    // at a time, each worker taking steadyBatchSize children at once
+    bool steadyState {false};
+    std::size_t steadyBatchSize {8};
+
+    // more than 0 keeps only the genomes and their fitness between generations and
+    // simulates this many robots at a time, for populations in the millions
+    std::size_t chunkSize {0};
+
+    // more than 0 runs robots with this many rules that can see sensorCount cells
+    // instead of the genes, a rule's sensor can also accept anything
+    std::size_t ruleCount {0};
+    std::size_t sensorCount {4};
+};
 
-// code representation
-constexpr int EMPTY {0};
-constexpr int WALL {1};
-constexpr int BATTERY {2};
+// Function Prototypes
+bool parseOptions(int argc, char* argv[], Options& options);
+bool applyCheckpointOptions(Options& options);
+std::unique_ptr<TelemetryWriter> openTelemetry(const Options& options);
+template <typename Grid>
+int runWithGeneCount(const Options& options, const Grid& grid);
+template <typename Grid, std::size_t GeneCount>
+int runGeneticAlgorithm(const Options& options, const Grid& grid);
+template <typename Grid, std::size_t GeneCount>
+int runIslandModel(const Options& options, const Grid& grid);
+template <typename Grid, std::size_t GeneCount>
+int runSteadyState(const Options& options, const Grid& grid);
+template <typename Grid, std::size_t GeneCount>
+int runChunked(const Options& options, const Grid& grid);
+template <typename Grid>
+int runRules(const Options& options, const Grid& grid);
+int runSweep(const Options& options);
+
+int main(int argc, char* argv[])
+{
+    Options options {};
 
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cerr << "Usage: " << argv[0] << " [--seed <number>] [--threads <count, 0 = all cores>] [--layouts <shared layout count, 0 = one per robot>] [--trials <layouts per robot>] [--batch]"
+                  << " [--grid <width>x<height>] [--batteries <percent, 0-99>] [--genes <8, 16 or 32>]"
+                  << " [--population <robots, a multiple of 4>] [--generations <count>] [--mutation <percent, 0-100>]"
+                  << " [--stats <file.csv or file.json>]"
+                  << " [--islands <count>] [--migration-interval <generations>] [--migrants <count>]"
+                  << " [--checkpoint <file> [--checkpoint-interval <generations>]] [--resume <file>] [--seed-population <file>]"
+                  << " [--telemetry <file>] [--telemetry-format <text or binary>] [--log-robots]"
+                  << " [--fixed-evaluation <seed> [--fitness-cache <entries>]]"
+                  << " [--selection <truncation, tournament, roulette, sus or rank>] [--tournament-size <robots>] [--rank-pressure <1-2>]"
+                  << " [--processes <count> [--process-batch <robots>] [--pin-workers]]"
+                  << " [--record <file> [--record-top <count>] [--record-robot <index>]...]"
+                  << " [--sweep <file> [--sweep-results <file.csv>]] [--steady-state [--steady-batch <robots>]]"
+                  << " [--chunk-size <robots>] [--rules <count> [--neighbourhood <4, 8 or 12>]]\n";
+        return 1;
+    }
 
-enum Direction
-{
-    North, // 0
-    South, // 1
-    East, // 2
-    West, // 3
+    if (!options.sweepPath.empty())
+        return runSweep(options);
 
-    RandomDir
-};
+    if (!applyCheckpointOptions(options))
+        return 1;
 
-// each gene has four sensor states for each direction
-// also has the action code that tells the robot what to do in the 
-// event the current sensor state matches the four states on the gene
-struct Gene
-{
-    std::array<int, 5 > sensorStates {};
-};
+    // the default world gets the compile time grid, anything else is sized at run time
+    if (options.width == DefaultGrid::width() && options.height == DefaultGrid::height() && options.batteryPercent == DefaultGrid::batteryPercent())
+        return runWithGeneCount(options, DefaultGrid {});
 
-// coordinates to show location on 10x10 grid
-struct Coordinates
-{
-    int x {};
-    int y {};
-};
+    return runWithGeneCount(options, DynamicGrid {options.width, options.height, options.batteryPercent});
+}
 
-class Map
+// fills in options from the command line, returns false if something is wrong
+bool parseOptions(int argc, char* argv[], Options& options)
 {
-    private:
-        // 2D array for the 10x10 grid
-        // putting 12 since the walls do not count as part of the 10x10 dimension
-        std::array<std::array<char, 12>, 12> m_map {};
-        int m_batteries {};
-    public:
-        Map()
-        // 40 percent of the map = 40 batteries 
-        : m_batteries {40}
+    try
+    {
+        for (int i {1}; i < argc; ++i)
         {
-            for (std::size_t i {0}; i < 12; ++i)
+            std::string argument {argv[i]};
+
+            if (argument == "--seed" && i + 1 < argc)
             {
-                for (std::size_t j {0}; j < 12; ++j)
-                {
-                    // place the walls at the edges of the map
-                    if (i == 0 || i == 11 || j == 0 || j == 11)
-                    {
-                        m_map[i][j] = 'W';
-                    }
-                    // put empty spots everywhere else
-                    else
-                    {
-                        m_map[i][j] = '-';
-                    }
-                }
+                options.seed = static_cast<std::uint32_t>(std::stoul(argv[++i]));
             }
-            // place the batteries
-            while(m_batteries != 0)
+            else if (argument == "--threads" && i + 1 < argc)
             {
-                // generate random coordinates for the batteries
-                int randomX {1 + (rand() % (10 - 1 + 1))};
-                int randomY {1 + (rand() % (10 - 1 + 1))};
-
-                // check to make sure that a battery is not already placed in that coordinate
-                // im static casting to size_t to get rid of compiler warnings
-                if (m_map[static_cast<std::size_t>(randomX)][static_cast<std::size_t>(randomY)] != 'B')
+                options.threadCount = static_cast<std::size_t>(std::stoul(argv[++i]));
+            }
+            else if (argument == "--layouts" && i + 1 < argc)
+            {
+                options.sharedLayoutCount = static_cast<std::size_t>(std::stoul(argv[++i]));
+            }
+            else if (argument == "--trials" && i + 1 < argc)
+            {
+                options.trials = static_cast<std::size_t>(std::stoul(argv[++i]));
+                if (options.trials == 0)
+                    options.trials = 1;
+            }
+            else if (argument == "--batch")
+            {
+                options.batched = true;
+            }
+            else if (argument == "--grid" && i + 1 < argc)
+            {
+                std::string size {argv[++i]};
+                std::size_t separator {size.find('x')};
+                if (separator == std::string::npos)
+                    return false;
+
+                options.width = std::stoi(size.substr(0, separator));
+                options.height = std::stoi(size.substr(separator + 1));
+                if (options.width < 1 || options.height < 1)
+                    return false;
+            }
+            else if (argument == "--batteries" && i + 1 < argc)
+            {
+                // robots need at least one empty spot to spawn on
+                options.batteryPercent = std::stoi(argv[++i]);
+                if (options.batteryPercent < 0 || options.batteryPercent > 99)
+                    return false;
+            }
+            else if (argument == "--genes" && i + 1 < argc)
+            {
+                options.geneCount = static_cast<std::size_t>(std::stoul(argv[++i]));
+                if (options.geneCount != 8 && options.geneCount != 16 && options.geneCount != 32)
+                    return false;
+            }
+            else if (argument == "--population" && i + 1 < argc)
+            {
+                options.populationSize = static_cast<std::size_t>(std::stoul(argv[++i]));
+                if (!isValidPopulationSize(options.populationSize))
                 {
-                    m_map[static_cast<std::size_t>(randomX)][static_cast<std::size_t>(randomY)] = 'B';
-                    --m_batteries;  
+                    std::cerr << "--population needs a multiple of 4 robots, it was " << options.populationSize << '\n';
+                    return false;
                 }
+            }
+            else if (argument == "--generations" && i + 1 < argc)
+            {
+                options.generations = std::stoi(argv[++i]);
+                if (options.generations < 1)
+                    return false;
+            }
+            else if (argument == "--mutation" && i + 1 < argc)
+            {
+                options.mutationPercent = std::stoi(argv[++i]);
+                if (options.mutationPercent < 0 || options.mutationPercent > 100)
+                    return false;
+            }
+            else if (argument == "--stats" && i + 1 < argc)
+            {
+                options.statsPath = argv[++i];
+            }
+            else if (argument == "--islands" && i + 1 < argc)
+            {
+                options.islandCount = static_cast<std::size_t>(std::stoul(argv[++i]));
+                if (options.islandCount == 0)
+                    options.islandCount = 1;
+            }
+            else if (argument == "--migration-interval" && i + 1 < argc)
+            {
+                options.migrationInterval = std::stoi(argv[++i]);
+                if (options.migrationInterval < 1)
+                    return false;
+            }
+            else if (argument == "--migrants" && i + 1 < argc)
+            {
+                options.migrantCount = static_cast<std::size_t>(std::stoul(argv[++i]));
+            }
+            else if (argument == "--checkpoint" && i + 1 < argc)
+            {
+                options.checkpointPath = argv[++i];
+            }
+            else if (argument == "--checkpoint-interval" && i + 1 < argc)
+            {
+                options.checkpointInterval = std::stoi(argv[++i]);
+                if (options.checkpointInterval < 1)
+                    return false;
+            }
+            else if (argument == "--resume" && i + 1 < argc)
+            {
+                options.resumePath = argv[++i];
+            }
+            else if (argument == "--seed-population" && i + 1 < argc)
+            {
+                options.seedPopulationPath = argv[++i];
+            }
+            else if (argument == "--telemetry" && i + 1 < argc)
+            {
+                options.telemetryPath = argv[++i];
+            }
+            else if (argument == "--telemetry-format" && i + 1 < argc)
+            {
+                std::string format {argv[++i]};
+                if (format == "text")
+                    options.telemetryFormat = TelemetryWriter::Format::Text;
+                else if (format == "binary")
+                    options.telemetryFormat = TelemetryWriter::Format::Binary;
                 else
-                {
-                    continue;
-                }
+                    return false;
             }
-        }
-
-        // position is empty if it contains a '-'
-        bool isPositionEmpty(int x, int y)
-        {
-            return m_map[static_cast<std::size_t>(x)][static_cast<std::size_t>(y)] == '-';
-        }
-
-        // place the robot onto the map
-        void placeRobot(int x, int y)
-        {
-            m_map[static_cast<std::size_t>(x)][static_cast<std::size_t>(y)] = 'R';
-        }
-
-        // get the coordinate above the current robot position
-        char getNorthCoordinate(int x, int y)
-        {
-            return m_map[static_cast<std::size_t>(x - 1)][static_cast<std::size_t>(y)];
-        }
-
-        // get the coordinate below the current robot position
-        char getSouthCoordinate(int x, int y)
-        {
-            return m_map[static_cast<std::size_t>(x + 1)][static_cast<std::size_t>(y)];
-        }
-
-        // get the coordinate to the right of the current robot position
-        char getEastCoordinate(int x, int y)
-        {
-            return m_map[static_cast<std::size_t>(x)][static_cast<std::size_t>(y + 1)];
-        }
-
-        // get the coordinate to the left of the current robot position
-        char getWestCoordinate(int x, int y)
-        {
-            return m_map[static_cast<std::size_t>(x)][static_cast<std::size_t>(y - 1)];
-        }
-
-        void moveNorth(int& x, int& y, int& power, int& turnsSurvived, int& powerHarvested)
-        {
-            // keep the robot in the same place if it is trying to move into a wall
-            // will still consume energy
-            if (m_map[static_cast<std::size_t>(x - 1)][static_cast<std::size_t>(y)] == 'W')
+            else if (argument == "--log-robots")
             {
-                --power;
-                ++turnsSurvived;
-                return;
+                options.logRobots = true;
             }
-            else if (m_map[static_cast<std::size_t>(x - 1)][static_cast<std::size_t>(y)] == 'B')
+            else if (argument == "--fixed-evaluation" && i + 1 < argc)
             {
-                x = x - 1;
-                placeRobot(x, y);
-
-                // robot gains 5 power when consuming battery
-                power+=5;
-                --power; // am confused if I am still to decrement power when robot consumes battery or not
-                ++turnsSurvived;
-                powerHarvested+=5;
+                options.fixedEvaluation = true;
+                options.evaluationSeed = static_cast<std::uint32_t>(std::stoul(argv[++i]));
             }
-            else
+            else if (argument == "--fitness-cache" && i + 1 < argc)
             {
-                --power;
-                ++turnsSurvived;
-
-                x = x - 1;
-                placeRobot(x, y);
+                options.fitnessCacheSize = static_cast<std::size_t>(std::stoul(argv[++i]));
             }
-
-            // Reset the position when the robot leaves it
-            m_map[static_cast<std::size_t>(x + 1)][static_cast<std::size_t>(y)] = '-';
-        }
-
-        void moveSouth(int& x, int& y, int& power, int& turnsSurvived, int& powerHarvested)
-        {
-            if (m_map[static_cast<std::size_t>(x + 1)][static_cast<std::size_t>(y)] == 'W')
+            else if (argument == "--selection" && i + 1 < argc)
             {
-                --power;
-                ++turnsSurvived;
-                return;
+                if (!parseSelectionScheme(argv[++i], options.selection.scheme))
+                    return false;
             }
-            else if (m_map[static_cast<std::size_t>(x + 1)][static_cast<std::size_t>(y)] == 'B')
+            else if (argument == "--tournament-size" && i + 1 < argc)
             {
-                x = x + 1;
-                placeRobot(x, y);
-
-                power+=5;
-                --power; // am confused if I am still to decrement power when robot consumes battery or not
-                ++turnsSurvived;
-                powerHarvested+=5;
+                options.selection.tournamentSize = static_cast<std::size_t>(std::stoul(argv[++i]));
+                if (options.selection.tournamentSize == 0)
+                    return false;
             }
-            else
+            else if (argument == "--rank-pressure" && i + 1 < argc)
             {
-                --power;
-                ++turnsSurvived;
-
-                x = x + 1;
-                placeRobot(x, y);
+                options.selection.rankPressure = std::stod(argv[++i]);
+                if (options.selection.rankPressure < 1.0 || options.selection.rankPressure > 2.0)
+                    return false;
             }
-
-            // Reset the position when the robot leaves it
-            m_map[static_cast<std::size_t>(x - 1)][static_cast<std::size_t>(y)] = '-';
-        }
-
-        void moveEast(int& x, int& y, int& power, int& turnsSurvived, int& powerHarvested)
-        {
-            if (m_map[static_cast<std::size_t>(x)][static_cast<std::size_t>(y + 1)] == 'W')
+            else if (argument == "--processes" && i + 1 < argc)
             {
-                --power;
-                ++turnsSurvived;
-                return;
+                options.processCount = static_cast<std::size_t>(std::stoul(argv[++i]));
             }
-            else if (m_map[static_cast<std::size_t>(x)][static_cast<std::size_t>(y + 1)] == 'B')
+            else if (argument == "--process-batch" && i + 1 < argc)
             {
-                y = y + 1;
-                placeRobot(x, y);
-
-                power+=5;
-                --power; // am confused if I am still to decrement power when robot consumes battery or not
-                ++turnsSurvived;
-                powerHarvested+=5;
+                options.processBatchSize = static_cast<std::size_t>(std::stoul(argv[++i]));
+                if (options.processBatchSize == 0)
+                    return false;
             }
-            else
+            else if (argument == "--pin-workers")
             {
-                --power;
-                ++turnsSurvived;
-
-                y = y + 1;
-                placeRobot(x, y);
+                options.pinWorkers = true;
             }
-
-            // Reset the position when the robot leaves it
-            m_map[static_cast<std::size_t>(x)][static_cast<std::size_t>(y - 1)] = '-';
-        }
-
-        void moveWest(int& x, int& y, int& power, int& turnsSurvived, int& powerHarvested)
-        {
-            if (m_map[static_cast<std::size_t>(x)][static_cast<std::size_t>(y - 1)] == 'W')
+            else if (argument == "--record" && i + 1 < argc)
             {
-                --power;
-                ++turnsSurvived;
-                return;
+                options.recordPath = argv[++i];
             }
-            else if (m_map[static_cast<std::size_t>(x)][static_cast<std::size_t>(y - 1)] == 'B')
+            else if (argument == "--record-top" && i + 1 < argc)
             {
-                y = y - 1;
-                placeRobot(x, y);
-
-                power+=5;
-                --power; // am confused if I am still to decrement power when robot consumes battery or not
-                ++turnsSurvived;
-                powerHarvested+=5;
+                options.record.topCount = static_cast<std::size_t>(std::stoul(argv[++i]));
+            }
+            else if (argument == "--record-robot" && i + 1 < argc)
+            {
+                options.record.robots.push_back(static_cast<std::size_t>(std::stoul(argv[++i])));
+            }
+            else if (argument == "--sweep" && i + 1 < argc)
+            {
+                options.sweepPath = argv[++i];
+            }
+            else if (argument == "--sweep-results" && i + 1 < argc)
+            {
+                options.sweepResultsPath = argv[++i];
+            }
+            else if (argument == "--steady-state")
+            {
+                options.steadyState = true;
+            }
+            else if (argument == "--steady-batch" && i + 1 < argc)
+            {
+                options.steadyBatchSize = static_cast<std::size_t>(std::stoul(argv[++i]));
+                if (options.steadyBatchSize == 0)
+                    return false;
+            }
+            else if (argument == "--chunk-size" && i + 1 < argc)
+            {
+                options.chunkSize = static_cast<std::size_t>(std::stoul(argv[++i]));
+                if (options.chunkSize == 0)
+                    return false;
+            }
+            else if (argument == "--rules" && i + 1 < argc)
+            {
+                // crossover takes half of the rules from each parent
+                options.ruleCount = static_cast<std::size_t>(std::stoul(argv[++i]));
+                if (options.ruleCount < 2)
+                    return false;
+            }
+            else if (argument == "--neighbourhood" && i + 1 < argc)
+            {
+                if (!parseNeighbourhood(argv[++i], options.sensorCount))
+                    return false;
             }
             else
             {
-                --power;
-                ++turnsSurvived;
-
-                y = y - 1;
-                placeRobot(x, y);
+                return false;
             }
-
-            // Reset the position when the robot leaves it
-            m_map[static_cast<std::size_t>(x)][static_cast<std::size_t>(y + 1)] = '-';
         }
+    }
+    catch (const std::exception&)
+    {
+        // not a number
+        return false;
+    }
+
+    // islands keep their own populations, which checkpoints don't cover
+    bool usesCheckpoints {!options.checkpointPath.empty() || !options.resumePath.empty() || !options.seedPopulationPath.empty()};
+    if (options.islandCount > 1 && usesCheckpoints)
+        return false;
+
+    // a cached score is only good for the trials it was made on
+    if (options.fitnessCacheSize > 0 && !options.fixedEvaluation)
+        return false;
+    if (options.islandCount > 1 && options.fixedEvaluation)
+        return false;
+
+    // worker processes score a generation in one go, without the cache or islands
+    if (options.processCount > 0 && (options.fitnessCacheSize > 0 || options.islandCount > 1))
+        return false;
+
+    // the best robot is recorded unless something else was asked for
+    bool choosesRobots {options.record.topCount > 0 || !options.record.robots.empty()};
+    if (options.recordPath.empty() && choosesRobots)
+        return false;
+    if (!options.recordPath.empty() && !choosesRobots)
+        options.record.topCount = 1;
+    if (options.islandCount > 1 && !options.recordPath.empty())
+        return false;
+
+    // islands send the robots at the front as their best, which only truncation guarantees
+    if (options.islandCount > 1 && options.selection.scheme != SelectionScheme::Truncation)
+        return false;
+
+    // a sweep only writes its results file, each of its runs is a plain single population
+    bool singleRun {usesCheckpoints || options.islandCount > 1 || options.fixedEvaluation || options.processCount > 0 || !options.recordPath.empty()
+                    || !options.statsPath.empty() || !options.telemetryPath.empty() || options.logRobots};
+    if (!options.sweepPath.empty() && singleRun)
+        return false;
+
+    // without generations there is nothing to checkpoint, record or log per robot, and
+    // parents are always picked by tournament
+    bool steadyScheme {options.selection.scheme == SelectionScheme::Truncation || options.selection.scheme == SelectionScheme::Tournament};
+    if (options.steadyState && (singleRun || !options.sweepPath.empty() || !steadyScheme))
+        return false;
+
+    // a chunked run keeps no robots between generations, only genomes and their fitness,
+    // so it can still write generation lines and stats but nothing about single robots
+    bool keepsRobots {usesCheckpoints || options.islandCount > 1 || options.fixedEvaluation || options.processCount > 0 || !options.recordPath.empty() || options.logRobots};
+    if (options.chunkSize > 0 && (keepsRobots || !options.sweepPath.empty() || options.steadyState))
+        return false;
+
+    // rule robots are their own kind of run, scored one at a time like a chunked run, and
+    // only they can see more than 4 cells
+    if (options.ruleCount > 0 && (keepsRobots || !options.sweepPath.empty() || options.steadyState || options.chunkSize > 0 || options.batched))
+        return false;
+    if (options.ruleCount == 0 && options.sensorCount != 4)
+        return false;
+
+    // binary records would make a mess of the console
+    if (options.telemetryFormat == TelemetryWriter::Format::Binary && options.telemetryPath.empty())
+        return false;
+
+    return !(!options.resumePath.empty() && !options.seedPopulationPath.empty());
+}
+
+// a resumed run takes the world, genes, seed, evaluation, selection and mutation chance
+// from the checkpoint so it carries on exactly like the saved run would have, on any
+// number of threads, a seeded run only takes the gene count
+bool applyCheckpointOptions(Options& options)
+{
+    const std::string& path {options.resumePath.empty() ? options.seedPopulationPath : options.resumePath};
+    if (path.empty())
+        return true;
+
+    CheckpointFile file {};
+    if (!file.open(path))
+    {
+        std::cerr << file.getError() << '\n';
+        return false;
+    }
+
+    const CheckpointHeader& header {file.header()};
+    options.geneCount = header.geneCount;
+    if (options.geneCount != 8 && options.geneCount != 16 && options.geneCount != 32)
+    {
+        std::cerr << path << " has " << options.geneCount << " genes per robot, this build runs 8, 16 or 32\n";
+        return false;
+    }
 
-        void moveRandom(int& x, int& y, int& power, int& turnsSurvived, int& powerHarvested)
+    if (!options.resumePath.empty())
+    {
+        options.seed = header.seed;
+        options.width = header.width;
+        options.height = header.height;
+        options.batteryPercent = header.batteryPercent;
+        options.sharedLayoutCount = header.sharedLayoutCount;
+        options.trials = header.trials;
+        options.fixedEvaluation = header.fixedEvaluation != 0;
+        options.evaluationSeed = header.evaluationSeed;
+        options.fitnessCacheSize = header.fitnessCacheSize;
+        options.selection.scheme = static_cast<SelectionScheme>(header.selectionScheme);
+        options.selection.tournamentSize = header.tournamentSize;
+        options.selection.rankPressure = header.rankPressure;
+        options.mutationPercent = header.mutationPercent;
+
+        // the checks of parseOptions() for the options that came from the file
+        if (options.fitnessCacheSize > 0 && options.processCount > 0)
         {
-            // get a random number used to choose the direction
-            int randomNum {rand() % 4};
-
-            switch (randomNum)
-            {
-            case 0:
-                moveNorth(x, y, power, turnsSurvived, powerHarvested);
-                break;
-            case 1:
-                moveSouth(x, y, power, turnsSurvived, powerHarvested);
-                break;
-            case 2:
-                moveEast(x, y, power, turnsSurvived, powerHarvested);
-                break;
-            case 3:
-                moveWest(x, y, power, turnsSurvived, powerHarvested);
-                break;
-            }
+            std::cerr << path << " was saved with a fitness cache, which worker processes don't use\n";
+            return false;
         }
-
-        void displayMap()
+        bool validSelection {header.selectionScheme <= static_cast<std::uint32_t>(SelectionScheme::Rank) && options.selection.tournamentSize > 0
+                             && options.selection.rankPressure >= 1.0 && options.selection.rankPressure <= 2.0};
+        if (!validSelection)
         {
-            // row
-            for (std::size_t i {0}; i < 12; ++i)
-            {
-                // column
-                for (std::size_t j {0}; j < 12; ++j)
-                {
-                    std::cout << m_map[i][j] << " ";
-
-                    // start a new line at the final column number
-                    if (j == 11)
-                    {
-                        std::cout << '\n';
-                    }
-                }
-            }
+            std::cerr << path << " has selection settings this build can't use\n";
+            return false;
         }
-};
+        if (options.mutationPercent < 0 || options.mutationPercent > 100)
+        {
+            std::cerr << path << " has a mutation chance of " << options.mutationPercent << " percent\n";
+            return false;
+        }
+    }
+    return true;
+}
 
-class Robot
+// the console in text mode unless a file was asked for, null if the file can't be opened
+std::unique_ptr<TelemetryWriter> openTelemetry(const Options& options)
 {
-    private:
-       std::array<Gene, 16> m_genes {};
-       int m_turnsSurvived {}; 
-       int m_power {};
-       Coordinates m_coordinates {};
-       Map m_map {};
-       std::array<int, 4> m_sensor {};
-       int m_powerHarvested {};
-    public:
-        Robot()
-        {
-            // robots start with power of 5 when they spawn on the map
-            m_power = 5;
-            // start 0 turns survived and power harvested = 0
-            m_turnsSurvived = 0;
-            m_powerHarvested = 0;
+    if (options.telemetryPath.empty())
+        return std::make_unique<TelemetryWriter>();
 
+    std::unique_ptr<TelemetryWriter> telemetry {std::make_unique<TelemetryWriter>(options.telemetryPath, options.telemetryFormat)};
+    if (!telemetry->isOpen())
+    {
+        std::cerr << "Could not open " << options.telemetryPath << '\n';
+        return nullptr;
+    }
+    return telemetry;
+}
 
-            // will show if the position is empty or not
-            bool validPosition {false};
+// the gene counts that get their own compiled version
+template <typename Grid>
+int runWithGeneCount(const Options& options, const Grid& grid)
+{
+    if (options.ruleCount > 0)
+        return runRules(options, grid);
 
-            // keep generating random coordinates until it is a valid coordinate
-            while (!validPosition)
-            {
-                // robots will spawn on a random 10x10 grid
-                m_coordinates.x = 1 + (rand() % (10 - 1 + 1));
-                m_coordinates.y = 1 + (rand() % (10 - 1 + 1));
+    switch (options.geneCount)
+    {
+    case 8:
+        return runGeneticAlgorithm<Grid, 8>(options, grid);
+    case 32:
+        return runGeneticAlgorithm<Grid, 32>(options, grid);
+    default:
+        return runGeneticAlgorithm<Grid, DEFAULT_GENE_COUNT>(options, grid);
+    }
+}
 
-                if (m_map.isPositionEmpty(m_coordinates.x, m_coordinates.y))
-                    validPosition = true;
-            }
+template <typename Grid, std::size_t GeneCount>
+int runGeneticAlgorithm(const Options& options, const Grid& grid)
+{
+    if (options.islandCount > 1)
+        return runIslandModel<Grid, GeneCount>(options, grid);
+    if (options.steadyState)
+        return runSteadyState<Grid, GeneCount>(options, grid);
+    if (options.chunkSize > 0)
+        return runChunked<Grid, GeneCount>(options, grid);
+
+    // the main thread uses this for building and breeding the robots
+    Rng rng {options.seed};
+
+    // worker processes have to be forked before any thread is started, so a run with them
+    // builds its layouts on this thread and starts the thread pool once they are forked
+    std::unique_ptr<ThreadPool> pool {};
+    if (options.processCount == 0)
+        pool = std::make_unique<ThreadPool>(options.threadCount);
+
+    // the seed of every robot's life is looked up by generation and robot index instead of
+    // drawn by the worker that runs it, so the same seed gives the same run on any number
+    // of threads or processes
+    CounterRng lifeRng {options.seed};
+
+    // a resumed run rebuilds everything from the checkpoint instead
+    CheckpointFile checkpoint {};
+    bool resuming {!options.resumePath.empty()};
+    if (resuming && !checkpoint.open(options.resumePath))
+    {
+        std::cerr << checkpoint.getError() << '\n';
+        return 1;
+    }
 
-            // fill the genes with random codes
-            // 0 = empty, 1 = wall, 2 = battery
-            // for the action code: 0 = north, 1 = south, 2 = east, 3 = west, 4 = random direction
-            for (std::size_t i {0}; i < m_genes.size(); ++i)
-            {
-                for (std::size_t j {0}; j < m_genes[i].sensorStates.size(); ++j)
-                {
-                    if (j < m_genes[i].sensorStates.size() - 1)
-                    {
-                        m_genes[i].sensorStates[j] = rand() % 3;
-                        continue;
-                    }
-                    if (j == m_genes[i].sensorStates.size() - 1)
-                    {
-                        m_genes[i].sensorStates[j] = rand() % 5;
-                        continue;
-                    }
-                }
-            }
-            // place the robot on the map with its randomly generated coordinates
-            m_map.placeRobot(m_coordinates.x, m_coordinates.y);
-        }
+    LayoutSource<Grid> layouts {resuming ? LayoutSource<Grid> {grid, savedSharedSeeds(checkpoint), pool.get()} : LayoutSource<Grid> {grid, options.sharedLayoutCount, rng, pool.get()}};
+    Population<Grid, GeneCount> robots {};
 
-        friend std::ostream& operator<<(std::ostream& out, Robot robot);
+    if (resuming)
+    {
+        restorePopulation(checkpoint, layouts, robots);
+        rng = Rng::fromState(checkpoint.header().mainRng);
+    }
+    else if (!options.seedPopulationPath.empty())
+    {
+        CheckpointFile seedFile {};
+        if (!seedFile.open(options.seedPopulationPath))
+        {
+            std::cerr << seedFile.getError() << '\n';
+            return 1;
+        }
+        seedPopulation(seedFile, layouts, rng, robots);
+    }
+    else
+    {
+        // create the population of 200 robots
+        robots = Population<Grid, GeneCount> {options.populationSize, layouts, rng};
+    }
+    robots.returnLayoutsTo(layouts);
 
-        // getter functions
-        int getPower() const {return m_power;}
-        int getTurnsSurvived() const {return m_turnsSurvived;}
-        int getPowerHarvested() const {return m_powerHarvested;}
+    // the same trials for every robot, and the scores already worked out on them
+    std::unique_ptr<EvaluationSet<Grid>> fixedSet {};
+    if (options.fixedEvaluation)
+        fixedSet = std::make_unique<EvaluationSet<Grid>>(grid, options.evaluationSeed, options.trials);
 
-        // get the top half of parent genes
-        std::array<Gene, 8> getGenesTopHalf() const 
+    // worker processes are forked once everything they need to score a robot is set up and
+    // before any thread is started
+    std::unique_ptr<ProcessEvaluator<Grid, GeneCount>> processes {};
+    if (options.processCount > 0)
+    {
+        ProcessSettings settings {};
+        settings.workerCount = options.processCount;
+        settings.batchSize = options.processBatchSize;
+        settings.pinWorkers = options.pinWorkers;
+        settings.batched = options.batched;
+        settings.trials = options.trials;
+
+        processes = std::make_unique<ProcessEvaluator<Grid, GeneCount>>(grid, layouts, settings, fixedSet.get());
+        if (!processes->start())
         {
-            std::array<Gene, 8> topHalf {};
-
-            for (std::size_t i {0}; i < m_genes.size() / 2; ++i)
-            {
-                topHalf[i] = m_genes[i];
-            }
-            return topHalf;
+            std::cerr << "Could not start the worker processes\n";
+            return 1;
         }
+    }
 
-        // get the bottom half of parent genes
-        std::array<Gene, 8> getGenesBottomHalf() const
-        {
-            std::array<Gene, 8> bottomHalf {};
+    if (!pool)
+        pool = std::make_unique<ThreadPool>(options.threadCount);
 
-            for (std::size_t i {0}; i < m_genes.size() / 2; ++i)
-            {
-                bottomHalf[i] = m_genes[i + (m_genes.size() / 2)];
-            }
-            return bottomHalf;
+    // scratch space for each worker that is reused every generation
+    std::vector<EvaluationArena<Grid, GeneCount>> arenas {};
+    arenas.reserve(pool->size());
+    for (std::size_t i {0}; i < pool->size(); ++i)
+    {
+        arenas.emplace_back(grid);
+    }
+
+    std::unique_ptr<TelemetryWriter> telemetry {openTelemetry(options)};
+    if (!telemetry)
+        return 1;
+
+    // per generation timings and counters, only written when asked for
+    std::unique_ptr<StatsWriter> stats {};
+    if (!options.statsPath.empty())
+    {
+        stats = std::make_unique<StatsWriter>(options.statsPath);
+        if (!stats->isOpen())
+        {
+            std::cerr << "Could not open " << options.statsPath << '\n';
+            return 1;
         }
+    }
 
-        void setPowerHarvested(int powerHarvested) {m_powerHarvested = powerHarvested;}
+    std::unique_ptr<FitnessCache<GeneCount>> cache {};
+    if (options.fitnessCacheSize > 0)
+        cache = std::make_unique<FitnessCache<GeneCount>>(options.fitnessCacheSize);
 
-        // set the child genes using the top half and bottom half of the parent genes
-        void setChildGenes(std::array<Gene, 8> topHalf, std::array<Gene, 8> bottomHalf)
+    std::unique_ptr<TrajectoryWriter> trajectories {};
+    std::unique_ptr<TrajectoryRecorder<Grid, GeneCount>> recorder {};
+    if (!options.recordPath.empty())
+    {
+        trajectories = std::make_unique<TrajectoryWriter>(options.recordPath, grid, GeneCount);
+        if (!trajectories->isOpen())
         {
-            for (std::size_t i {0}; i < m_genes.size(); ++i)
-            {
-                if (i < m_genes.size() / 2)
-                {
-                    m_genes[i] = topHalf[i];
-                }
-                else
-                {
-                    m_genes[i] = bottomHalf[i - (m_genes.size() / 2)];
-                }
-            }
-            int mutationProbability {rand() % 100};
-            int geneToMutateIndex {rand() % 16};
-            int sensorStateToMutateIndex {rand() % 4};
-            int mutationValue {rand() % 3};
+            std::cerr << "Could not open " << options.recordPath << '\n';
+            return 1;
+        }
+        recorder = std::make_unique<TrajectoryRecorder<Grid, GeneCount>>(options.record, *trajectories);
+    }
 
-            if (mutationProbability < 5) {
-                // 5% chance
-                m_genes[static_cast<std::size_t>(geneToMutateIndex)].sensorStates[static_cast<std::size_t>(sensorStateToMutateIndex)] = mutationValue;
-            }
+    // the generation steps, with the evaluation picked above
+    RobotEvaluator<Grid, GeneCount> evaluator {*pool, lifeRng, arenas, layouts, options.trials, options.batched};
+    evaluator.useFixedSet(fixedSet.get());
+    evaluator.useCache(cache.get());
+    evaluator.useProcesses(processes.get());
+    if (resuming)
+        evaluator.startAtGeneration(static_cast<std::uint32_t>(checkpoint.header().generation));
+    RobotEngine<Grid, GeneCount> engine {evaluator, Selector {options.selection}, HalfCrossover {}, PointMutation {options.mutationPercent}};
+
+    // what a resumed run takes over from the checkpoints of this one
+    CheckpointSettings checkpointSettings {};
+    checkpointSettings.seed = options.seed;
+    checkpointSettings.trials = options.trials;
+    checkpointSettings.fixedEvaluation = options.fixedEvaluation;
+    checkpointSettings.evaluationSeed = options.evaluationSeed;
+    checkpointSettings.fitnessCacheSize = options.fitnessCacheSize;
+    checkpointSettings.selection = options.selection;
+    checkpointSettings.mutationPercent = options.mutationPercent;
+
+    // keep track of number of generations
+    int generation {resuming ? static_cast<int>(checkpoint.header().generation) : 0};
+
+    // run through 100 generations 
+    // print the fitness score for each generation
+    while (generation < options.generations)
+    {
+        PhaseTimer timer {};
+        PhaseTimes times {};
+
+        if (!engine.evaluate(robots))
+        {
+            std::cerr << "The worker processes could not score generation " << generation << '\n';
+            return 1;
         }
+        times.evaluate = timer.lap();
 
-        // * The display functions are just used for testing
-        // display the map for a specific robot
-        void displayMap()
+        double totalFitness {};
+        double totalFitnessMin {};
+        double totalFitnessVariance {};
+        for (std::size_t i {0}; i < robots.size(); ++i)
         {
-            m_map.displayMap();
+            totalFitness += robots.getFitness(i);
+            totalFitnessMin += robots.getFitnessMin(i);
+            totalFitnessVariance += robots.getFitnessVariance(i);
         }
+        double robotCount {static_cast<double>(robots.size())};
+
+        // with more than one trial this also shows how much the score moves between layouts
+        telemetry->writeGeneration(GenerationRecord {GenerationRecordType, static_cast<std::uint32_t>(generation), static_cast<std::uint32_t>(robots.size()), static_cast<std::uint32_t>(options.trials),
+                                                     totalFitness / robotCount, totalFitnessMin / robotCount, totalFitnessVariance / robotCount});
 
-        // display the genes for a specific robot
-        void displayGenes()
+        if (options.logRobots)
         {
-            for (std::size_t i {0}; i < m_genes.size(); ++i)
+            for (std::size_t i {0}; i < robots.size(); ++i)
             {
-                for (std::size_t j {0}; j < m_genes[i].sensorStates.size(); ++j)
-                {
-                    std::cout << m_genes[i].sensorStates[j] << " ";
-                }
-                std::cout << '\n';
+                telemetry->writeRobot(RobotRecord {RobotRecordType, static_cast<std::uint32_t>(generation), static_cast<std::uint32_t>(i), robots.getFitnessMin(i),
+                                                   robots.getFitness(i), robots.getFitnessVariance(i), robots.getPowerHarvested(i), robots.getTurnsSurvived(i)});
             }
         }
-
-        // display the sensor for a specific robot
-        // need to call updateSensor() first to get accurate reading
-        void displaySensor()
+        telemetry->endGeneration();
+
+        if (recorder)
+            recorder->record(generation, robots, fixedSet.get());
+
+        // half of the robots are kept as parents, picking them is timed as the sort and
+        // moving them to the front as the cull
+        timer.lap();
+        const std::vector<std::size_t>& parents {engine.pickParents(robots, rng)};
+        times.sort = timer.lap();
+        robots.reorder(parents);
+        times.cull = timer.lap();
+        engine.breed(robots, rng);
+        times.breed = timer.lap();
+
+        if (stats)
         {
-            for (std::size_t i {0}; i < m_sensor.size(); ++i)
+            SimulationCounters counters {};
+            for (EvaluationArena<Grid, GeneCount>& arena : arenas)
             {
-                std::cout << m_sensor[i] << " ";
+                arena.takeCounters(counters);
             }
+            if (processes)
+                processes->takeCounters(counters);
+            stats->writeGeneration(generation, totalFitness / robotCount, times, counters);
         }
 
-        // get the sensor's readings in each direction
-        void updateSensor()
+        // increment generation
+        ++generation;
+
+        if (!options.checkpointPath.empty() && generation % options.checkpointInterval == 0)
         {
-            // North direction
-            switch (m_map.getNorthCoordinate(m_coordinates.x, m_coordinates.y))
-            {
-            case '-':
-                m_sensor[North] = EMPTY;
-                break;
-            case 'W':
-                m_sensor[North] = WALL;
-                break;
-            case 'B':
-                m_sensor[North] = BATTERY;
-                break;
-            }
-
-            // South direction
-            switch (m_map.getSouthCoordinate(m_coordinates.x, m_coordinates.y))
-            {
-            case '-':
-                m_sensor[South] = EMPTY;
-                break;
-            case 'W':
-                m_sensor[South] = WALL;
-                break;
-            case 'B':
-                m_sensor[South] = BATTERY;
-                break;
-            }
-
-            // East direction
-            switch (m_map.getEastCoordinate(m_coordinates.x, m_coordinates.y))
-            {
-            case '-':
-                m_sensor[East] = EMPTY;
-                break;
-            case 'W':
-                m_sensor[East] = WALL;
-                break;
-            case 'B':
-                m_sensor[East] = BATTERY;
-                break;
-            }
-
-            // West direction
-            switch (m_map.getWestCoordinate(m_coordinates.x, m_coordinates.y))
-            {
-            case '-':
-                m_sensor[West] = EMPTY;
-                break;
-            case 'W':
-                m_sensor[West] = WALL;
-                break;
-            case 'B':
-                m_sensor[West] = BATTERY;
-                break;
-            }
+            if (!saveCheckpoint(options.checkpointPath, checkpointSettings, static_cast<std::uint64_t>(generation), robots, layouts, rng))
+                std::cerr << "Could not save a checkpoint to " << options.checkpointPath << '\n';
         }
 
-        // move the robot based on what the action code tells it to do
-        void moveRobot(int actionCode)
+    }
+
+    if (cache)
+    {
+        telemetry->writeText("Fitness Cache: " + std::to_string(cache->getHits()) + " hits, " + std::to_string(cache->getDuplicates()) + " duplicates, "
+                             + std::to_string(cache->getMisses()) + " misses, " + std::to_string(cache->getEvictions()) + " evictions\n");
+    }
+
+    return 0;
+}
+
+// every island runs its own population on its own thread, --threads is not used here
+// the results are printed once every island is done, averaged over the islands
+template <typename Grid, std::size_t GeneCount>
+int runIslandModel(const Options& options, const Grid& grid)
+{
+    Rng rng {options.seed};
+
+    IslandSettings settings {};
+    settings.islandCount = options.islandCount;
+    settings.migrationInterval = options.migrationInterval;
+    settings.migrantCount = options.migrantCount;
+    settings.sharedLayoutCount = options.sharedLayoutCount;
+    settings.trials = options.trials;
+    settings.batched = options.batched;
+    settings.populationSize = options.populationSize;
+    settings.generations = options.generations;
+    settings.mutationPercent = options.mutationPercent;
+
+    std::unique_ptr<TelemetryWriter> telemetry {openTelemetry(options)};
+    if (!telemetry)
+        return 1;
+
+    std::unique_ptr<StatsWriter> stats {};
+    if (!options.statsPath.empty())
+    {
+        stats = std::make_unique<StatsWriter>(options.statsPath);
+        if (!stats->isOpen())
         {
-            switch (actionCode)
-            {
-                // 0
-            case North:
-                m_map.moveNorth(m_coordinates.x, m_coordinates.y, m_power, m_turnsSurvived, m_powerHarvested);
-                break;
-                // 1
-            case South:
-                m_map.moveSouth(m_coordinates.x, m_coordinates.y, m_power, m_turnsSurvived, m_powerHarvested);
-                break;
-                // 2
-            case East:
-                m_map.moveEast(m_coordinates.x, m_coordinates.y, m_power, m_turnsSurvived, m_powerHarvested);
-                break;
-                // 3
-            case West:
-                m_map.moveWest(m_coordinates.x, m_coordinates.y, m_power, m_turnsSurvived, m_powerHarvested);
-                break;
-                // Random direction
-            case 4:
-                m_map.moveRandom(m_coordinates.x, m_coordinates.y, m_power, m_turnsSurvived, m_powerHarvested);
-                break;
-            }
+            std::cerr << "Could not open " << options.statsPath << '\n';
+            return 1;
         }
+    }
+
+    IslandModel<Grid, GeneCount> islands {grid, settings, rng};
+    islands.run();
 
-        // see if there is a match with the sensor and one of the 16 genes
-        // if there is not a match, follow the instruction from the 16th gene
-        void update()
+    for (int generation {0}; generation < settings.generations; ++generation)
+    {
+        double totalFitness {};
+        PhaseTimes times {};
+        SimulationCounters counters {};
+        for (std::size_t i {0}; i < islands.size(); ++i)
         {
-            int actionCode {};
+            const Island<Grid, GeneCount>& island {islands.getIsland(i)};
+            totalFitness += island.getAverageFitness(generation);
+
+            // phases are added up over the islands, so they are thread time not wall time
+            times.evaluate += island.getTimes(generation).evaluate;
+            times.sort += island.getTimes(generation).sort;
+            times.cull += island.getTimes(generation).cull;
+            times.breed += island.getTimes(generation).breed;
+            counters += island.getCounters(generation);
+        }
+        double averageFitness {totalFitness / static_cast<double>(islands.size())};
 
-            // loop through the genes
-            for (std::size_t i {0}; i < m_genes.size(); ++i)
-            {
-                bool match {true};
+        telemetry->writeGeneration(GenerationRecord {GenerationRecordType, static_cast<std::uint32_t>(generation), static_cast<std::uint32_t>(settings.populationSize * islands.size()), 1,
+                                                     averageFitness, 0.0, 0.0});
 
-                // loop through the genomes
-                for (std::size_t j {0}; j < m_genes[i].sensorStates.size() - 1; ++j)
-                {
-                    // if an element in the sensor is not equal to the genome,
-                    // break and go to the next gene
-                    if (m_sensor[j] != m_genes[i].sensorStates[j])
-                    {
-                        match = false;
-                        break;  
-                    }
-                }
-                // successful match
-                if (match)
-                {
-                    // set actionCode equal to the last element in the gene
-                    actionCode = m_genes[i].sensorStates[4];
+        std::string islandLine {"    Islands:"};
+        for (std::size_t i {0}; i < islands.size(); ++i)
+        {
+            islandLine += ' ' + std::to_string(static_cast<int>(islands.getIsland(i).getAverageFitness(generation)));
+        }
+        telemetry->writeText(islandLine + '\n');
 
-                    moveRobot(actionCode);
+        if (stats)
+            stats->writeGeneration(generation, averageFitness, times, counters);
+    }
 
-                    return;
-                }   
-            }
-            // if there were no matches, use the instruction from the very last gene
-            actionCode = m_genes[15].sensorStates[4];
+    for (std::size_t i {0}; i < islands.size(); ++i)
+    {
+        telemetry->writeText("Island " + std::to_string(i) + " sent " + std::to_string(islands.getIsland(i).getMigrantsSent()) + " migrants and took in "
+                             + std::to_string(islands.getIsland(i).getMigrantsReceived()) + '\n');
+    }
 
-            moveRobot(actionCode);  
-        }
-};
+    return 0;
+}
 
-// Function Prototypes
-void sortVector(std::vector<Robot>& robots);
-void destroyBottom50Percent(std::vector<Robot>& robots);
-void breedRobots(std::vector<Robot>& robots);
+// the steady state run on --threads workers, printed once every worker is done with the
+// average fitness at the points where the generational run would have printed it
+template <typename Grid, std::size_t GeneCount>
+int runSteadyState(const Options& options, const Grid& grid)
+{
+    Rng rng {options.seed};
+
+    SteadyStateSettings settings {};
+    settings.workerCount = options.threadCount;
+    settings.populationSize = options.populationSize;
+    settings.generations = options.generations;
+    settings.batchSize = options.steadyBatchSize;
+    settings.tournamentSize = options.selection.tournamentSize;
+    settings.mutationPercent = options.mutationPercent;
+    settings.trials = options.trials;
+    settings.batched = options.batched;
+
+    std::unique_ptr<TelemetryWriter> telemetry {openTelemetry(options)};
+    if (!telemetry)
+        return 1;
+
+    // drawn the same way LayoutSource draws them
+    std::vector<std::uint32_t> sharedSeeds {};
+    for (std::size_t i {0}; i < options.sharedLayoutCount; ++i)
+    {
+        sharedSeeds.push_back(rng.nextSeed());
+    }
+
+    SteadyStateModel<Grid, GeneCount> model {grid, settings, sharedSeeds, rng};
+    model.run();
+
+    const SteadyStatePopulation<GeneCount>& population {model.getPopulation()};
+    for (std::size_t generation {0}; generation < population.getReportCount(); ++generation)
+    {
+        telemetry->writeGeneration(GenerationRecord {GenerationRecordType, static_cast<std::uint32_t>(generation), static_cast<std::uint32_t>(settings.populationSize), 1,
+                                                     population.getAverageFitness(generation), 0.0, 0.0});
+    }
+
+    telemetry->writeText("Steady State: " + std::to_string(population.getEvaluations()) + " robots scored on " + std::to_string(model.size()) + " threads in "
+                         + std::to_string(model.getSeconds()) + " seconds, " + std::to_string(population.getKept()) + " kept, " + std::to_string(population.getDropped())
+                         + " dropped, " + std::to_string(static_cast<int>(model.getSimulatingShare() * 100.0 + 0.5)) + "% of thread time simulating\n");
+
+    return 0;
+}
 
-int main()
+// the generations of main() on a population that only keeps its genomes, simulated
+// options.chunkSize robots at a time
+template <typename Grid, std::size_t GeneCount>
+int runChunked(const Options& options, const Grid& grid)
 {
-    // seed the randomizer using current time
-    srand(time(NULL));
+    Rng rng {options.seed};
+    ThreadPool pool {options.threadCount};
+    CounterRng lifeRng {options.seed};
 
-    // determines if robot is still alive or not
-    bool alive {true};
+    std::vector<EvaluationArena<Grid, GeneCount>> arenas {};
+    arenas.reserve(pool.size());
+    for (std::size_t i {0}; i < pool.size(); ++i)
+    {
+        arenas.emplace_back(grid);
+    }
 
-    // create the population of 200 robots
-    std::vector<Robot> robots(200);
+    LayoutSource<Grid> layouts {grid, options.sharedLayoutCount, rng, &pool};
+    GenomePopulation<Genome<GeneCount>> robots {options.populationSize, [&rng]() {return Genome<GeneCount>::random(rng);}};
 
-    // keep track of number of generations
-    int generation {};
+    std::unique_ptr<TelemetryWriter> telemetry {openTelemetry(options)};
+    if (!telemetry)
+        return 1;
 
-    // run through 100 generations 
-    // print the fitness score for each generation
-    while (generation < 100)
+    std::unique_ptr<StatsWriter> stats {};
+    if (!options.statsPath.empty())
+    {
+        stats = std::make_unique<StatsWriter>(options.statsPath);
+        if (!stats->isOpen())
+        {
+            std::cerr << "Could not open " << options.statsPath << '\n';
+            return 1;
+        }
+    }
+
+    ChunkedEngine<Grid, GeneCount> engine {ChunkedEvaluator<Grid, GeneCount> {pool, lifeRng, arenas, layouts, options.trials, options.batched, options.chunkSize},
+                                           Selector {options.selection}, HalfCrossover {}, PointMutation {options.mutationPercent}};
+    const ChunkedEvaluator<Grid, GeneCount>& evaluator {engine.getEvaluator()};
+
+    for (int generation {0}; generation < options.generations; ++generation)
     {
-        int totalPowerHarvested {};
+        PhaseTimer timer {};
+        PhaseTimes times {};
+
+        engine.evaluate(robots);
+        times.evaluate = timer.lap();
 
+        double totalFitness {};
+        double totalFitnessMin {};
+        double totalFitnessVariance {};
         for (std::size_t i {0}; i < robots.size(); ++i)
         {
-            // set each new robot to alive
-            alive = true;
-            while (alive)
-            {
-                if (robots[i].getPower() == 0)
-                {
-                    // calculate the total power
-                    totalPowerHarvested += robots[i].getPowerHarvested();
-                    // kill the robot when power is 0
-                    alive = false;
-                }
-                else
-                {
-                    // update everything for it to move across the map
-                    robots[i].updateSensor();
-                    robots[i].update();
-                }
-            }
+            totalFitness += robots.getFitness(i);
+            totalFitnessMin += robots.getFitnessMin(i);
+            totalFitnessVariance += robots.getFitnessVariance(i);
         }
+        double robotCount {static_cast<double>(robots.size())};
 
-        std::cout << "The Average Fitness Score for Generation #" << generation << ": " << (totalPowerHarvested / static_cast<int>(robots.size())) << '\n';
+        telemetry->writeGeneration(GenerationRecord {GenerationRecordType, static_cast<std::uint32_t>(generation), static_cast<std::uint32_t>(robots.size()), static_cast<std::uint32_t>(options.trials),
+                                                     totalFitness / robotCount, totalFitnessMin / robotCount, totalFitnessVariance / robotCount});
+        telemetry->endGeneration();
 
-        sortVector(robots);
-        destroyBottom50Percent(robots); 
-        breedRobots(robots);
-
-        // increment generation
-        ++generation;
+        timer.lap();
+        const std::vector<std::size_t>& parents {engine.pickParents(robots, rng)};
+        times.sort = timer.lap();
+        robots.reorder(parents);
+        times.cull = timer.lap();
+        engine.breed(robots, rng);
+        times.breed = timer.lap();
 
+        if (stats)
+        {
+            SimulationCounters counters {};
+            for (EvaluationArena<Grid, GeneCount>& arena : arenas)
+            {
+                arena.takeCounters(counters);
+            }
+            stats->writeGeneration(generation, totalFitness / robotCount, times, counters);
+        }
     }
-    
+
+    telemetry->writeText("Chunked Evaluation: " + std::to_string(evaluator.getChunkCount()) + " chunks of up to " + std::to_string(evaluator.getChunkSize()) + " robots, "
+                         + std::to_string(robots.residentBytes() / (1024 * 1024)) + " MB kept between generations, "
+                         + std::to_string(robots.residentBytes() / robots.capacity()) + " bytes per robot\n");
+
     return 0;
 }
 
-// prints relevant information for a robot
-// ***Mainly for testing***
-std::ostream& operator<<(std::ostream& out, Robot robot)
+// the generations of main() with rule robots, the population only keeps genomes and a
+// robot is put on a layout when it is scored, like in a chunked run
+template <typename Grid>
+int runRules(const Options& options, const Grid& grid)
 {
-    out << "***Genes***\n";
-    robot.displayGenes();
+    Rng rng {options.seed};
+    ThreadPool pool {options.threadCount};
+    CounterRng lifeRng {options.seed};
 
-    out << "***Map***\n";
-    robot.displayMap();
+    std::vector<std::unique_ptr<RuleArena<Grid>>> arenas {};
+    for (std::size_t i {0}; i < pool.size(); ++i)
+    {
+        arenas.push_back(std::make_unique<RuleArena<Grid>>(grid, options.sensorCount));
+    }
 
-    out << "***Sensor***\n";
-    robot.updateSensor();
-    robot.displaySensor();
-    
-    std::cout << '\n';
+    LayoutSource<Grid> layouts {grid, options.sharedLayoutCount, rng, &pool};
+    GenomePopulation<RuleGenome> robots {options.populationSize, [&]() {return RuleGenome::random(options.ruleCount, options.sensorCount, rng);}};
 
-    out << "***Turns Survived***\n" << robot.getTurnsSurvived() << '\n';
-    out << "***Power***\n" << robot.getPower() << '\n';
-    out << "***Power Harvested***\n" << robot.getPowerHarvested() << '\n';
+    std::unique_ptr<TelemetryWriter> telemetry {openTelemetry(options)};
+    if (!telemetry)
+        return 1;
 
-    return out;
-}
+    std::unique_ptr<StatsWriter> stats {};
+    if (!options.statsPath.empty())
+    {
+        stats = std::make_unique<StatsWriter>(options.statsPath);
+        if (!stats->isOpen())
+        {
+            std::cerr << "Could not open " << options.statsPath << '\n';
+            return 1;
+        }
+    }
 
-// sorts the robot's power harvested from greatest to least
-void sortVector(std::vector<Robot>& robots) 
-{
-    std::sort(robots.begin(), robots.end(), [](const Robot& a, const Robot& b) {
-        return a.getPowerHarvested() > b.getPowerHarvested();
-    });
-}
+    RuleEngine<Grid> engine {RuleEvaluator<Grid> {pool, lifeRng, arenas, layouts, options.trials}, Selector {options.selection}, RuleCrossover {}, RuleMutation {options.mutationPercent}};
 
-// deletes the robots that are in the bottom 50 percent in power harvested.
-void destroyBottom50Percent(std::vector<Robot>& robots) 
-{
-    // compute the index to erase from
-    int size = static_cast<int>(robots.size() / 2);  // Floor result by default
+    for (int generation {0}; generation < options.generations; ++generation)
+    {
+        PhaseTimer timer {};
+        PhaseTimes times {};
+
+        engine.evaluate(robots);
+        times.evaluate = timer.lap();
+
+        double totalFitness {};
+        double totalFitnessMin {};
+        double totalFitnessVariance {};
+        for (std::size_t i {0}; i < robots.size(); ++i)
+        {
+            totalFitness += robots.getFitness(i);
+            totalFitnessMin += robots.getFitnessMin(i);
+            totalFitnessVariance += robots.getFitnessVariance(i);
+        }
+        double robotCount {static_cast<double>(robots.size())};
 
-    // destroy robots from the halfway point to the end
-    robots.erase(robots.begin() + size, robots.end());
+        telemetry->writeGeneration(GenerationRecord {GenerationRecordType, static_cast<std::uint32_t>(generation), static_cast<std::uint32_t>(robots.size()), static_cast<std::uint32_t>(options.trials),
+                                                     totalFitness / robotCount, totalFitnessMin / robotCount, totalFitnessVariance / robotCount});
+        telemetry->endGeneration();
+
+        timer.lap();
+        const std::vector<std::size_t>& parents {engine.pickParents(robots, rng)};
+        times.sort = timer.lap();
+        robots.reorder(parents);
+        times.cull = timer.lap();
+        engine.breed(robots, rng);
+        times.breed = timer.lap();
+
+        if (stats)
+        {
+            SimulationCounters counters {};
+            for (std::unique_ptr<RuleArena<Grid>>& arena : arenas)
+            {
+                arena->takeCounters(counters);
+            }
+            stats->writeGeneration(generation, totalFitness / robotCount, times, counters);
+        }
+    }
+
+    return 0;
 }
 
-void breedRobots(std::vector<Robot>& robots)
+// every run of the sweep file is one job on a work stealing pool, a worker runs one job
+// at a time from start to finish, so the machine stays busy however long each run is
+// the results are written in the order of the sweep file as soon as every earlier run is done
+int runSweep(const Options& options)
 {
-    std::vector<Robot> newRobots; // Container for new robots
+    SweepConfig base {};
+    base.seed = options.seed;
+    base.populationSize = options.populationSize;
+    base.generations = options.generations;
+    base.mutationPercent = options.mutationPercent;
+    base.width = options.width;
+    base.height = options.height;
+    base.batteryPercent = options.batteryPercent;
+    base.geneCount = options.geneCount;
+    base.trials = options.trials;
+    base.sharedLayoutCount = options.sharedLayoutCount;
+    base.selection = options.selection;
+    base.batched = options.batched;
+
+    SweepPlan plan {};
+    if (!plan.load(options.sweepPath, base))
+    {
+        std::cerr << plan.getError() << '\n';
+        return 1;
+    }
 
-    // Iterate through the robots in pairs
-    for (std::size_t i = 0; i + 1 < robots.size(); i += 2)
+    SweepResultsWriter results {options.sweepResultsPath};
+    if (!results.isOpen())
     {
-        const Robot& parentRobot1 = robots[i];
-        const Robot& parentRobot2 = robots[i + 1];
+        std::cerr << "Could not open " << options.sweepResultsPath << '\n';
+        return 1;
+    }
+
+    std::vector<SweepCurve> curves(plan.size());
+    std::vector<bool> finished(plan.size());
+    std::size_t nextToWrite {0};
+    std::mutex resultsMutex {};
 
-        // Create child robots with combined genes
-        Robot childRobot1 {};
-        childRobot1.setChildGenes(parentRobot1.getGenesTopHalf(), parentRobot2.getGenesTopHalf());
+    JobPool pool {options.threadCount};
+    PhaseTimer timer {};
 
-        Robot childRobot2 {};
-        childRobot2.setChildGenes(parentRobot1.getGenesBottomHalf(), parentRobot2.getGenesBottomHalf());
+    for (std::size_t job : plan.longestFirst())
+    {
+        pool.submit([&, job](std::size_t)
+        {
+            SweepCurve curve {runSweepConfig(plan.getJob(job))};
 
-        // Store new robots in the temporary vector
-        newRobots.push_back(childRobot1);
-        newRobots.push_back(childRobot2);
+            std::lock_guard<std::mutex> lock {resultsMutex};
+            curves[job] = std::move(curve);
+            finished[job] = true;
+
+            while (nextToWrite < plan.size() && finished[nextToWrite])
+            {
+                const SweepCurve& written {curves[nextToWrite]};
+                results.writeJob(nextToWrite, plan.getJob(nextToWrite), written);
+                std::cout << "Job " << nextToWrite + 1 << " of " << plan.size() << ": Seed " << plan.getJob(nextToWrite).seed
+                          << ", Average Fitness: " << written.averageFitness.back() << ", Best Fitness: " << written.bestFitness.back() << '\n';
+
+                // nothing reads a curve once it is in the file
+                curves[nextToWrite] = SweepCurve {};
+                ++nextToWrite;
+            }
+        });
     }
+    pool.wait();
 
-    // Add all new robots to the original vector
-    robots.insert(robots.end(), newRobots.begin(), newRobots.end());
+    std::cout << "Sweep: " << plan.size() << " runs on " << pool.size() << " threads in " << timer.lap() << " seconds, "
+              << pool.getSteals() << " runs stolen by idle threads\n";
+    return 0;
 }
@@ -0,0 +1,172 @@
+#ifndef RULE_GENOME_H
+#define RULE_GENOME_H
+
+#include <iostream>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "map.h"
+#include "rng.h"
+
+// genomes for robots that see more than the 4 cells next to them, for --rules
+// a rule is a sensor code for every cell the robot can see plus an action, like a gene,
+// but a sensor can also accept any code, and a genome can have thousands of rules
+//
+// a rule is packed into 32 bits:
+// 2 bits for each sensor, in the order of SENSOR_OFFSETS, then the action code at bit 24
+// so a neighbourhood can have at most 12 cells
+
+// the sensor code that accepts whatever the cell holds
+constexpr int ANY_CODE {3};
+
+constexpr std::size_t MAX_SENSORS {12};
+constexpr std::size_t RULE_ACTION_SHIFT {24};
+
+// where every sensor looks from the robot, as rows and columns
+// the first 4 are north, south, east and west like a gene, then the 4 diagonals, then
+// the 4 cells two steps away in a straight line
+struct SensorOffset
+{
+    int rows {};
+    int columns {};
+};
+
+constexpr std::array<SensorOffset, MAX_SENSORS> SENSOR_OFFSETS {{
+    {-1, 0}, {1, 0}, {0, 1}, {0, -1},
+    {-1, 1}, {-1, -1}, {1, 1}, {1, -1},
+    {-2, 0}, {2, 0}, {0, 2}, {0, -2},
+}};
+
+// the neighbourhoods that can be asked for: the 4 cells next to the robot, the 8 around
+// it, or every cell up to 2 steps away, returns false if name is not one of them
+inline bool parseNeighbourhood(const std::string& name, std::size_t& sensorCount)
+{
+    if (name == "4")
+        sensorCount = 4;
+    else if (name == "8")
+        sensorCount = 8;
+    else if (name == "12")
+        sensorCount = 12;
+    else
+        return false;
+    return true;
+}
+
+class RuleGenome
+{
+    private:
+        std::vector<std::uint32_t> m_rules {};
+        std::size_t m_sensorCount {4};
+
+        static constexpr std::uint32_t SENSOR_MASK {3};
+        static constexpr std::uint32_t ACTION_MASK {7};
+    public:
+        RuleGenome() = default;
+
+        RuleGenome(std::size_t ruleCount, std::size_t sensorCount)
+        : m_rules(ruleCount)
+        , m_sensorCount {sensorCount}
+        {
+        }
+
+        // every sensor gets one of the 4 codes, so a quarter of them accept anything
+        static RuleGenome random(std::size_t ruleCount, std::size_t sensorCount, Rng& rng)
+        {
+            RuleGenome genome {ruleCount, sensorCount};
+
+            for (std::size_t i {0}; i < ruleCount; ++i)
+            {
+                for (std::size_t j {0}; j < sensorCount; ++j)
+                {
+                    genome.setSensor(i, j, rng.nextInt(4));
+                }
+                genome.setAction(i, rng.nextInt(5));
+            }
+            return genome;
+        }
+
+        std::size_t size() const {return m_rules.size();}
+        std::size_t getSensorCount() const {return m_sensorCount;}
+
+        int getSensor(std::size_t rule, std::size_t sensor) const {return static_cast<int>((m_rules[rule] >> (sensor * 2)) & SENSOR_MASK);}
+        int getAction(std::size_t rule) const {return static_cast<int>((m_rules[rule] >> RULE_ACTION_SHIFT) & ACTION_MASK);}
+
+        void setSensor(std::size_t rule, std::size_t sensor, int code)
+        {
+            m_rules[rule] &= ~(SENSOR_MASK << (sensor * 2));
+            m_rules[rule] |= (static_cast<std::uint32_t>(code) & SENSOR_MASK) << (sensor * 2);
+        }
+
+        void setAction(std::size_t rule, int action)
+        {
+            m_rules[rule] &= ~(ACTION_MASK << RULE_ACTION_SHIFT);
+            m_rules[rule] |= (static_cast<std::uint32_t>(action) & ACTION_MASK) << RULE_ACTION_SHIFT;
+        }
+
+        // the rules of a parent, copied whole so the child keeps the order they are tried in
+        void copyRules(const RuleGenome& parent, std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i {begin}; i < end; ++i)
+            {
+                m_rules[i] = parent.m_rules[i];
+            }
+        }
+
+        // like Genome::mutate(), always draws the same 4 numbers and only ever changes a sensor
+        void mutate(Rng& rng, int mutationPercent)
+        {
+            int mutationProbability {rng.nextInt(100)};
+            int ruleToMutateIndex {rng.nextInt(static_cast<int>(m_rules.size()))};
+            int sensorToMutateIndex {rng.nextInt(static_cast<int>(m_sensorCount))};
+            int mutationValue {rng.nextInt(4)};
+
+            if (mutationProbability < mutationPercent)
+                setSensor(static_cast<std::size_t>(ruleToMutateIndex), static_cast<std::size_t>(sensorToMutateIndex), mutationValue);
+        }
+
+        // the first rule that accepts a reading of one code per sensor, or size() if none does
+        // this is the linear scan RuleIndex replaces, kept to check the index against
+        std::size_t firstMatch(const std::uint8_t* reading) const
+        {
+            for (std::size_t i {0}; i < m_rules.size(); ++i)
+            {
+                bool matches {true};
+                for (std::size_t j {0}; j < m_sensorCount && matches; ++j)
+                {
+                    int code {getSensor(i, j)};
+                    matches = code == ANY_CODE || code == reading[j];
+                }
+                if (matches)
+                    return i;
+            }
+            return m_rules.size();
+        }
+
+        // display the rules, one rule per line with * for a sensor that accepts anything
+        void displayRules(std::ostream& out = std::cout) const
+        {
+            std::string text {};
+            text.reserve(m_rules.size() * (m_sensorCount + 1) * 2);
+
+            for (std::size_t i {0}; i < m_rules.size(); ++i)
+            {
+                for (std::size_t j {0}; j < m_sensorCount; ++j)
+                {
+                    int code {getSensor(i, j)};
+                    text += code == ANY_CODE ? '*' : static_cast<char>('0' + code);
+                    text += ' ';
+                }
+                text += static_cast<char>('0' + getAction(i));
+                text += '\n';
+            }
+            out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        }
+
+        friend bool operator==(const RuleGenome& a, const RuleGenome& b) {return a.m_sensorCount == b.m_sensorCount && a.m_rules == b.m_rules;}
+        friend bool operator!=(const RuleGenome& a, const RuleGenome& b) {return !(a == b);}
+};
+
+#endif
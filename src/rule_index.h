@@ -0,0 +1,98 @@
+#ifndef RULE_INDEX_H
+#define RULE_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rule_genome.h"
+
+// a RuleGenome compiled for matching, so a step does not have to scan every rule
+// for every sensor and every code it can read there is one bit per rule saying whether
+// the rule accepts it, and the rules that accept a whole reading are the AND of one of
+// those rows per sensor
+//
+// the rows are stored 64 rules at a time, every sensor's rows for the first 64 rules
+// next to each other, then the next 64, so the first word with a bit left is usually
+// found after one small block of memory and most steps never look at the later rules
+//
+// compile() reuses the memory of the last genome, so an arena compiles every robot it
+// scores without allocating once it has seen the longest genome
+class RuleIndex
+{
+    private:
+        // empty, wall and battery
+        static constexpr std::size_t CODE_COUNT {3};
+
+        std::size_t m_sensorCount {};
+        std::size_t m_ruleCount {};
+        std::size_t m_wordCount {};
+        std::vector<std::uint64_t> m_accepts {};
+        std::vector<std::uint8_t> m_actions {};
+
+        std::size_t rowOf(std::size_t word, std::size_t sensor, std::size_t code) const
+        {
+            return (word * m_sensorCount + sensor) * CODE_COUNT + code;
+        }
+    public:
+        RuleIndex() = default;
+
+        explicit RuleIndex(const RuleGenome& genome)
+        {
+            compile(genome);
+        }
+
+        void compile(const RuleGenome& genome)
+        {
+            m_sensorCount = genome.getSensorCount();
+            m_ruleCount = genome.size();
+            m_wordCount = (m_ruleCount + 63) / 64;
+            m_accepts.assign(m_wordCount * m_sensorCount * CODE_COUNT, 0);
+            m_actions.resize(m_ruleCount);
+
+            for (std::size_t i {0}; i < m_ruleCount; ++i)
+            {
+                std::uint64_t bit {std::uint64_t {1} << (i % 64)};
+                for (std::size_t sensor {0}; sensor < m_sensorCount; ++sensor)
+                {
+                    int code {genome.getSensor(i, sensor)};
+                    for (std::size_t accepted {0}; accepted < CODE_COUNT; ++accepted)
+                    {
+                        if (code == ANY_CODE || static_cast<std::size_t>(code) == accepted)
+                            m_accepts[rowOf(i / 64, sensor, accepted)] |= bit;
+                    }
+                }
+                m_actions[i] = static_cast<std::uint8_t>(genome.getAction(i));
+            }
+        }
+
+        std::size_t size() const {return m_ruleCount;}
+
+        // the same answer as RuleGenome::firstMatch()
+        std::size_t firstMatch(const std::uint8_t* reading) const
+        {
+            for (std::size_t word {0}; word < m_wordCount; ++word)
+            {
+                const std::uint64_t* rows {&m_accepts[rowOf(word, 0, 0)]};
+                std::uint64_t matches {~std::uint64_t {0}};
+                for (std::size_t sensor {0}; sensor < m_sensorCount; ++sensor)
+                {
+                    matches &= rows[sensor * CODE_COUNT + reading[sensor]];
+                }
+
+                if (matches != 0)
+                    return word * 64 + static_cast<std::size_t>(__builtin_ctzll(matches));
+            }
+            return m_ruleCount;
+        }
+
+        // the action of the first rule that accepts the reading, falling back to the last
+        // rule when none of them do, like the action table of a Genome
+        int action(const std::uint8_t* reading) const
+        {
+            std::size_t rule {firstMatch(reading)};
+            return m_actions[rule < m_ruleCount ? rule : m_ruleCount - 1];
+        }
+};
+
+#endif
@@ -0,0 +1,257 @@
+#ifndef RULE_ROBOT_H
+#define RULE_ROBOT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "counter_rng.h"
+#include "cycle_tracker.h"
+#include "evaluation_arena.h"
+#include "genetic_engine.h"
+#include "genome.h"
+#include "map.h"
+#include "population.h"
+#include "rng.h"
+#include "robot.h"
+#include "rule_genome.h"
+#include "rule_index.h"
+#include "selection.h"
+#include "stats.h"
+#include "thread_pool.h"
+
+// robots run by a RuleGenome instead of a Genome, for --rules
+// they live on the same maps and move the same way, only how they pick a move differs
+
+// one rule robot living on its map, the rule version of Robot
+template <typename Grid>
+class RuleRobot
+{
+    private:
+        const RuleIndex* m_index {nullptr};
+        std::size_t m_sensorCount {};
+        int m_turnsSurvived {};
+        int m_power {};
+        Coordinates m_coordinates {};
+        Map<Grid> m_map;
+        // the code every sensor reads, in the order of SENSOR_OFFSETS
+        std::array<std::uint8_t, MAX_SENSORS> m_reading {};
+        int m_powerHarvested {};
+    public:
+        RuleRobot(const RuleIndex& index, std::size_t sensorCount, const BatteryLayout<Grid>& layout, Coordinates coordinates)
+        : m_index {&index}
+        , m_sensorCount {sensorCount}
+        , m_turnsSurvived {0}
+        , m_power {STARTING_POWER}
+        , m_coordinates {coordinates}
+        , m_map {layout}
+        , m_powerHarvested {0}
+        {
+        }
+
+        // start a new life on another layout, the compiled rules are kept
+        void respawn(const BatteryLayout<Grid>& layout, Coordinates coordinates)
+        {
+            m_map.reset(layout);
+            m_coordinates = coordinates;
+            m_power = STARTING_POWER;
+            m_turnsSurvived = 0;
+            m_powerHarvested = 0;
+        }
+
+        // getter functions
+        int getPower() const {return m_power;}
+        int getTurnsSurvived() const {return m_turnsSurvived;}
+        int getPowerHarvested() const {return m_powerHarvested;}
+        Coordinates getCoordinates() const {return m_coordinates;}
+
+        // read every cell of the neighbourhood
+        void updateSensor()
+        {
+            for (std::size_t i {0}; i < m_sensorCount; ++i)
+            {
+                m_reading[i] = static_cast<std::uint8_t>(m_map.getCodeOrWall(m_coordinates.x + SENSOR_OFFSETS[i].rows, m_coordinates.y + SENSOR_OFFSETS[i].columns));
+            }
+        }
+
+        void update(Rng& rng)
+        {
+            m_map.move(m_index->action(m_reading.data()), m_coordinates.x, m_coordinates.y, m_power, m_turnsSurvived, m_powerHarvested, rng);
+        }
+
+        // the same as Robot::runLife(), a robot that sees further still only depends on
+        // the map and its random state, so its loops can be skipped the same way
+        void runLife(Rng& rng, CycleTracker<Grid>& cycles)
+        {
+            const Grid& grid {m_map.getGrid()};
+            cycles.reset();
+
+            while (m_power != 0)
+            {
+                std::size_t loopStart {cycles.visit(grid.cellIndex(m_coordinates.x, m_coordinates.y))};
+                if (loopStart != CycleTracker<Grid>::NOT_SEEN)
+                {
+                    std::size_t remaining {static_cast<std::size_t>(m_power)};
+                    std::size_t cell {cycles.cellAfter(loopStart, remaining)};
+                    GA_COUNT(steps, remaining);
+                    GA_COUNT(wallBumps, cycles.wallBumpsAfter(loopStart, remaining));
+
+                    m_coordinates.x = static_cast<int>(cell / static_cast<std::size_t>(grid.rowLength()));
+                    m_coordinates.y = static_cast<int>(cell % static_cast<std::size_t>(grid.rowLength()));
+                    m_turnsSurvived += m_power;
+                    m_power = 0;
+                    return;
+                }
+
+                updateSensor();
+                int action {m_index->action(m_reading.data())};
+                int powerHarvested {m_powerHarvested};
+                m_map.move(action, m_coordinates.x, m_coordinates.y, m_power, m_turnsSurvived, m_powerHarvested, rng);
+
+                // the map or the random state changed, so the path so far can't repeat
+                if (action == RandomDir || m_powerHarvested != powerHarvested)
+                    cycles.reset();
+            }
+        }
+};
+
+// scratch space owned by one worker thread, the rule version of EvaluationArena
+// every trial is on a layout picked with the trial's own random stream, so a robot needs
+// nothing but its genome and life seed to be scored
+template <typename Grid>
+class RuleArena
+{
+    public:
+        using PopulationType = GenomePopulation<RuleGenome>;
+    private:
+        BatteryLayout<Grid> m_layout {};
+        CycleTracker<Grid> m_cycles {};
+        RuleIndex m_index {};
+        RuleRobot<Grid> m_robot;
+        std::vector<int> m_scores {};
+        std::vector<std::uint32_t> m_lifeSeeds {};
+
+        SimulationCounters m_counters {};
+    public:
+        RuleArena(const Grid& grid, std::size_t sensorCount)
+        : m_layout {grid}
+        , m_cycles {grid}
+        , m_robot {m_index, sensorCount, m_layout, Coordinates {}}
+        {
+        }
+
+        // the arena holds itself, so it stays where it was built
+        RuleArena(const RuleArena&) = delete;
+        RuleArena& operator=(const RuleArena&) = delete;
+
+        // scores the robots of [begin, end) that have no score yet
+        void evaluateRange(PopulationType& robots, std::size_t begin, std::size_t end, const LayoutSource<Grid>& layouts, std::size_t trials, const LifeSeeds& seeds)
+        {
+            m_scores.resize(trials);
+            m_lifeSeeds.resize(end - begin);
+            seeds.fill(begin, end, m_lifeSeeds.data());
+
+            for (std::size_t i {begin}; i < end; ++i)
+            {
+                if (robots.isScored(i))
+                    continue;
+
+                m_index.compile(robots.getGenome(i));
+                for (std::size_t t {0}; t < trials; ++t)
+                {
+                    Rng robotRng {trialRng(m_lifeSeeds[i - begin], t)};
+                    const BatteryLayout<Grid>& layout {layouts.trialLayout(m_layout, robotRng)};
+                    m_robot.respawn(layout, layout.spawnRobot(robotRng));
+
+                    m_robot.runLife(robotRng, m_cycles);
+                    m_scores[t] = m_robot.getPowerHarvested();
+                    GA_COUNT(lives, 1);
+                }
+
+                storeTrialScores(robots, i, m_scores.data(), trials);
+            }
+            takeThreadCounters(m_counters);
+        }
+
+        // add what this arena counted to total and start again from zero
+        void takeCounters(SimulationCounters& total)
+        {
+            total += m_counters;
+            m_counters = SimulationCounters {};
+        }
+};
+
+// scores rule robots on the thread pool, the life seeds are looked up the same way
+// RobotEvaluator looks them up, so a run is the same on any number of threads
+template <typename Grid>
+class RuleEvaluator
+{
+    public:
+        using PopulationType = GenomePopulation<RuleGenome>;
+    private:
+        ThreadPool& m_pool;
+        CounterRng m_lifeRng {};
+        std::vector<std::unique_ptr<RuleArena<Grid>>>& m_arenas;
+        const LayoutSource<Grid>& m_layouts;
+        std::size_t m_trials {1};
+        std::uint32_t m_generation {0};
+    public:
+        RuleEvaluator(ThreadPool& pool, const CounterRng& lifeRng, std::vector<std::unique_ptr<RuleArena<Grid>>>& arenas, const LayoutSource<Grid>& layouts, std::size_t trials)
+        : m_pool {pool}
+        , m_lifeRng {lifeRng}
+        , m_arenas {arenas}
+        , m_layouts {layouts}
+        , m_trials {trials}
+        {
+        }
+
+        bool evaluate(PopulationType& robots)
+        {
+            LifeSeeds seeds {m_lifeRng, m_generation++};
+            m_pool.parallelFor(robots.size(), [&](std::size_t begin, std::size_t end, std::size_t worker)
+            {
+                m_arenas[worker]->evaluateRange(robots, begin, end, m_layouts, m_trials, seeds);
+            });
+            return true;
+        }
+
+        // a child is only a genome until it is scored
+        std::size_t addChild(PopulationType& robots, Rng&)
+        {
+            return robots.addRobot();
+        }
+};
+
+// child 0 takes the first half of its rules from a and the rest from b, child 1 the other
+// way round, so every rule keeps its place in the order the rules are tried
+struct RuleCrossover
+{
+    void operator()(const RuleGenome& a, const RuleGenome& b, std::size_t child, RuleGenome& out) const
+    {
+        // a slot that has held a genome of this size already is reused as it is
+        if (out.size() != a.size() || out.getSensorCount() != a.getSensorCount())
+            out = RuleGenome {a.size(), a.getSensorCount()};
+
+        std::size_t half {a.size() / 2};
+        out.copyRules(child == 0 ? a : b, 0, half);
+        out.copyRules(child == 0 ? b : a, half, a.size());
+    }
+};
+
+// a 5% chance of changing one sensor of one rule unless another percent is given
+struct RuleMutation
+{
+    int percent {DEFAULT_MUTATION_PERCENT};
+
+    void operator()(RuleGenome& genome, Rng& rng) const
+    {
+        genome.mutate(rng, percent);
+    }
+};
+
+template <typename Grid>
+using RuleEngine = GeneticEngine<RuleGenome, RuleEvaluator<Grid>, Selector, RuleCrossover, RuleMutation>;
+
+#endif
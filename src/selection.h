@@ -0,0 +1,301 @@
+#ifndef SELECTION_H
+#define SELECTION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "rng.h"
+
+// ways of picking the parents of the next generation, chosen on the command line
+// every scheme only looks at the fitness array and hands back the indices of the parents,
+// the population moves its robots once afterwards
+enum class SelectionScheme
+{
+    // the best half, like the original sort and erase
+    Truncation,
+    // the best of a few robots picked at random, once per parent
+    Tournament,
+    // chance proportional to fitness, one spin per parent
+    Roulette,
+    // chance proportional to fitness, one spin with evenly spaced pointers for every parent
+    StochasticUniversal,
+    // chance by place in the fitness order instead of by fitness
+    Rank,
+};
+
+struct SelectionSettings
+{
+    SelectionScheme scheme {SelectionScheme::Truncation};
+    // robots in each tournament
+    std::size_t tournamentSize {2};
+    // how many times the chance of the best robot is over the average one, from 1 to 2
+    double rankPressure {1.5};
+};
+
+// returns false if name is not a scheme
+inline bool parseSelectionScheme(const std::string& name, SelectionScheme& scheme)
+{
+    if (name == "truncation")
+        scheme = SelectionScheme::Truncation;
+    else if (name == "tournament")
+        scheme = SelectionScheme::Tournament;
+    else if (name == "roulette")
+        scheme = SelectionScheme::Roulette;
+    else if (name == "sus")
+        scheme = SelectionScheme::StochasticUniversal;
+    else if (name == "rank")
+        scheme = SelectionScheme::Rank;
+    else
+        return false;
+    return true;
+}
+
+// the name parseSelectionScheme() takes for scheme
+inline const char* selectionSchemeName(SelectionScheme scheme)
+{
+    switch (scheme)
+    {
+    case SelectionScheme::Tournament:
+        return "tournament";
+    case SelectionScheme::Roulette:
+        return "roulette";
+    case SelectionScheme::StochasticUniversal:
+        return "sus";
+    case SelectionScheme::Rank:
+        return "rank";
+    default:
+        return "truncation";
+    }
+}
+
+// keeps its scratch arrays between generations so selecting never allocates once they are big enough
+//
+// truncation is O(n + k log k) with nth_element, tournament is O(k * size), roulette is
+// O(n + k log n), stochastic universal sampling is O(n + k), rank needs the whole order but
+// fitness is harvested power with plenty of ties, so it counts the robots on each of the d
+// different values in O(n + d log d) and only sorts the indices in O(n log n) when most of
+// them are different, the robots themselves are never sorted
+class Selector
+{
+    private:
+        SelectionSettings m_settings {};
+        std::vector<std::size_t> m_parents {};
+        std::vector<std::size_t> m_order {};
+        // how many robots have each fitness value, and the different values, for rank selection
+        std::unordered_map<double, std::size_t> m_counts {};
+        std::vector<double> m_values {};
+        // running total of the weights, m_totals[i] covers robots 0 to i
+        std::vector<double> m_totals {};
+
+        // higher fitness first, ties go to the lower index so every scheme gives the same
+        // order no matter how the indices are sorted
+        static bool isBetter(const std::vector<double>& fitness, std::size_t a, std::size_t b)
+        {
+            return fitness[a] > fitness[b] || (fitness[a] == fitness[b] && a < b);
+        }
+
+        void selectTruncation(const std::vector<double>& fitness, std::size_t size, std::size_t count)
+        {
+            m_parents.resize(size);
+            for (std::size_t i {0}; i < size; ++i)
+            {
+                m_parents[i] = i;
+            }
+
+            auto better = [&fitness](std::size_t a, std::size_t b) {return isBetter(fitness, a, b);};
+            std::vector<std::size_t>::iterator last {m_parents.begin() + static_cast<std::ptrdiff_t>(count)};
+            std::nth_element(m_parents.begin(), last, m_parents.end(), better);
+            // breeding pairs neighbours, so the parents still go best first
+            std::sort(m_parents.begin(), last, better);
+            m_parents.resize(count);
+        }
+
+        void selectTournament(const std::vector<double>& fitness, std::size_t size, std::size_t count, Rng& rng)
+        {
+            std::size_t tournamentSize {std::max<std::size_t>(m_settings.tournamentSize, 1)};
+            for (std::size_t i {0}; i < count; ++i)
+            {
+                std::size_t winner {static_cast<std::size_t>(rng.nextInt(static_cast<int>(size)))};
+                for (std::size_t round {1}; round < tournamentSize; ++round)
+                {
+                    std::size_t challenger {static_cast<std::size_t>(rng.nextInt(static_cast<int>(size)))};
+                    if (isBetter(fitness, challenger, winner))
+                        winner = challenger;
+                }
+                m_parents.push_back(winner);
+            }
+        }
+
+        // the running totals of the weights of robots 0 to size - 1, each weight is given by weightOf(i)
+        // a population with no weight at all is picked from evenly
+        template <typename WeightOf>
+        double buildTotals(std::size_t size, WeightOf weightOf)
+        {
+            m_totals.resize(size);
+            double total {0.0};
+            for (std::size_t i {0}; i < size; ++i)
+            {
+                total += std::max(weightOf(i), 0.0);
+                m_totals[i] = total;
+            }
+
+            if (total > 0.0)
+                return total;
+
+            for (std::size_t i {0}; i < size; ++i)
+            {
+                m_totals[i] = static_cast<double>(i + 1);
+            }
+            return static_cast<double>(size);
+        }
+
+        // the robot whose share of the running total covers point
+        std::size_t robotAt(double point) const
+        {
+            std::vector<double>::const_iterator found {std::upper_bound(m_totals.begin(), m_totals.end(), point)};
+            if (found == m_totals.end())
+                --found;
+            return static_cast<std::size_t>(found - m_totals.begin());
+        }
+
+        void spinRoulette(double total, std::size_t count, Rng& rng)
+        {
+            for (std::size_t i {0}; i < count; ++i)
+            {
+                m_parents.push_back(robotAt(rng.nextDouble() * total));
+            }
+        }
+
+        // count pointers spaced total / count apart, walked through the totals in one pass
+        void sampleUniversal(double total, std::size_t count, Rng& rng)
+        {
+            double spacing {total / static_cast<double>(count)};
+            double point {rng.nextDouble() * spacing};
+            std::size_t robot {0};
+            for (std::size_t i {0}; i < count; ++i)
+            {
+                while (robot + 1 < m_totals.size() && m_totals[robot] <= point)
+                {
+                    ++robot;
+                }
+                m_parents.push_back(robot);
+                point += spacing;
+            }
+
+            // the pointers come out in index order, shuffle them so breeding does not
+            // always pair a robot with its neighbour in the array
+            for (std::size_t i {count - 1}; i > 0; --i)
+            {
+                std::size_t j {static_cast<std::size_t>(rng.nextInt(static_cast<int>(i + 1)))};
+                std::swap(m_parents[i], m_parents[j]);
+            }
+        }
+
+        // puts every robot in m_order best first by counting how many robots share each fitness
+        // value, only the different values are sorted so it is O(n + d log d) for d values
+        // gives up and returns false once more than a quarter of the robots have a value of their
+        // own, the full sort is quicker than the counting by then
+        bool orderByCounting(const std::vector<double>& fitness, std::size_t size)
+        {
+            std::size_t limit {size / 4};
+            m_counts.clear();
+            m_values.clear();
+            for (std::size_t i {0}; i < size; ++i)
+            {
+                std::pair<std::unordered_map<double, std::size_t>::iterator, bool> found {m_counts.emplace(fitness[i], 0)};
+                if (found.second)
+                {
+                    if (m_values.size() == limit)
+                        return false;
+                    m_values.push_back(fitness[i]);
+                }
+                ++found.first->second;
+            }
+
+            // turn the counts into the rank of the first robot with each value
+            std::sort(m_values.begin(), m_values.end(), [](double a, double b) {return a > b;});
+            std::size_t rank {0};
+            for (double value : m_values)
+            {
+                std::size_t& count {m_counts[value]};
+                std::size_t first {rank};
+                rank += count;
+                count = first;
+            }
+
+            // robots with the same fitness go in index order, the same tie break as isBetter
+            m_order.resize(size);
+            for (std::size_t i {0}; i < size; ++i)
+            {
+                m_order[m_counts[fitness[i]]++] = i;
+            }
+            return true;
+        }
+
+        // linear ranking, the worst robot gets 2 - pressure shares and the best gets pressure shares
+        void selectRank(const std::vector<double>& fitness, std::size_t size, std::size_t count, Rng& rng)
+        {
+            if (!orderByCounting(fitness, size))
+            {
+                m_order.resize(size);
+                for (std::size_t i {0}; i < size; ++i)
+                {
+                    m_order[i] = i;
+                }
+                std::sort(m_order.begin(), m_order.end(), [&fitness](std::size_t a, std::size_t b) {return isBetter(fitness, a, b);});
+            }
+
+            double pressure {std::min(std::max(m_settings.rankPressure, 1.0), 2.0)};
+            double step {size > 1 ? 2.0 * (pressure - 1.0) / static_cast<double>(size - 1) : 0.0};
+            double total {buildTotals(size, [&](std::size_t rank) {return pressure - step * static_cast<double>(rank);})};
+            sampleUniversal(total, count, rng);
+
+            // the totals were over ranks, turn them back into robots
+            for (std::size_t& parent : m_parents)
+            {
+                parent = m_order[parent];
+            }
+        }
+    public:
+        explicit Selector(const SelectionSettings& settings = SelectionSettings {})
+        : m_settings {settings}
+        {
+        }
+
+        const SelectionSettings& getSettings() const {return m_settings;}
+
+        // pick count parents out of the first size robots, a robot may be picked more than once
+        // except by truncation, fitness can be longer than size
+        const std::vector<std::size_t>& select(const std::vector<double>& fitness, std::size_t size, std::size_t count, Rng& rng)
+        {
+            m_parents.clear();
+            if (size == 0 || count == 0)
+                return m_parents;
+
+            switch (m_settings.scheme)
+            {
+            case SelectionScheme::Truncation:
+                selectTruncation(fitness, size, std::min(count, size));
+                break;
+            case SelectionScheme::Tournament:
+                selectTournament(fitness, size, count, rng);
+                break;
+            case SelectionScheme::Roulette:
+                spinRoulette(buildTotals(size, [&fitness](std::size_t i) {return fitness[i];}), count, rng);
+                break;
+            case SelectionScheme::StochasticUniversal:
+                sampleUniversal(buildTotals(size, [&fitness](std::size_t i) {return fitness[i];}), count, rng);
+                break;
+            case SelectionScheme::Rank:
+                selectRank(fitness, size, count, rng);
+                break;
+            }
+            return m_parents;
+        }
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// bounded queue for exactly one producer thread and one consumer thread
+// neither side ever blocks: pushing to a full queue or popping an empty one just fails
+//
+// the producer only writes m_tail and the consumer only writes m_head, each on its
+// own cache line, so the two threads never fight over a lock or a line
+template <typename T>
+class SpscQueue
+{
+    private:
+        std::vector<T> m_slots {};
+        std::size_t m_mask {};
+        alignas(64) std::atomic<std::size_t> m_head {0};
+        alignas(64) std::atomic<std::size_t> m_tail {0};
+    public:
+        // the capacity is rounded up to a power of 2 so wrapping is a mask
+        explicit SpscQueue(std::size_t capacity)
+        {
+            std::size_t size {1};
+            while (size < capacity)
+            {
+                size *= 2;
+            }
+            m_slots.resize(size);
+            m_mask = size - 1;
+        }
+
+        std::size_t capacity() const {return m_slots.size();}
+
+        // producer side
+        bool tryPush(const T& value)
+        {
+            std::size_t tail {m_tail.load(std::memory_order_relaxed)};
+            if (tail - m_head.load(std::memory_order_acquire) == m_slots.size())
+                return false;
+
+            m_slots[tail & m_mask] = value;
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // consumer side
+        bool tryPop(T& value)
+        {
+            std::size_t head {m_head.load(std::memory_order_relaxed)};
+            if (head == m_tail.load(std::memory_order_acquire))
+                return false;
+
+            value = m_slots[head & m_mask];
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+};
+
+#endif
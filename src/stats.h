@@ -0,0 +1,141 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// instrumentation for --stats
+// phase times are always measured since it is only a few clock reads per generation,
+// the simulation counters sit in the hot loop so they are only built in when the
+// GA_ENABLE_STATS option is on, otherwise GA_COUNT() expands to nothing
+
+// what happened inside the simulation, summed over every robot life
+struct SimulationCounters
+{
+    std::uint64_t steps {};
+    std::uint64_t wallBumps {};
+    std::uint64_t batteryPickups {};
+    std::uint64_t randomActions {};
+    std::uint64_t lives {};
+
+    SimulationCounters& operator+=(const SimulationCounters& other)
+    {
+        steps += other.steps;
+        wallBumps += other.wallBumps;
+        batteryPickups += other.batteryPickups;
+        randomActions += other.randomActions;
+        lives += other.lives;
+        return *this;
+    }
+};
+
+#if defined(GA_ENABLE_STATS)
+constexpr bool STATS_ENABLED {true};
+
+// every thread counts into its own copy so workers never share a cache line,
+// the evaluation arenas move them out after each range
+inline thread_local SimulationCounters threadCounters {};
+
+#define GA_COUNT(counter, amount) (threadCounters.counter += static_cast<std::uint64_t>(amount))
+#else
+constexpr bool STATS_ENABLED {false};
+
+// the amount is never evaluated, so popcounts and the like cost nothing either
+#define GA_COUNT(counter, amount) static_cast<void>(0)
+#endif
+
+// add this thread's counters to total and start counting from zero again
+inline void takeThreadCounters([[maybe_unused]] SimulationCounters& total)
+{
+#if defined(GA_ENABLE_STATS)
+    total += threadCounters;
+    threadCounters = SimulationCounters {};
+#endif
+}
+
+// wall time of each phase of one generation
+struct PhaseTimes
+{
+    double evaluate {};
+    double sort {};
+    double cull {};
+    double breed {};
+};
+
+// measures the time between laps
+class PhaseTimer
+{
+    private:
+        std::chrono::steady_clock::time_point m_start {std::chrono::steady_clock::now()};
+    public:
+        // seconds since the last lap, or since the timer was made
+        double lap()
+        {
+            std::chrono::steady_clock::time_point now {std::chrono::steady_clock::now()};
+            double seconds {std::chrono::duration<double>(now - m_start).count()};
+            m_start = now;
+            return seconds;
+        }
+};
+
+// writes one row per generation, as CSV or as one JSON object per line
+// a path ending in .json or .jsonl gets JSON, anything else gets CSV
+// the counter columns are left out of builds without GA_ENABLE_STATS
+class StatsWriter
+{
+    private:
+        std::ofstream m_out {};
+        bool m_json {false};
+
+        static bool endsWith(const std::string& text, const std::string& ending)
+        {
+            return text.size() >= ending.size() && text.compare(text.size() - ending.size(), ending.size(), ending) == 0;
+        }
+    public:
+        explicit StatsWriter(const std::string& path)
+        : m_out {path}
+        , m_json {endsWith(path, ".json") || endsWith(path, ".jsonl")}
+        {
+            if (!m_json && m_out)
+            {
+                m_out << "generation,average_fitness,evaluate_seconds,sort_seconds,cull_seconds,breed_seconds";
+                if (STATS_ENABLED)
+                    m_out << ",steps,wall_bumps,battery_pickups,random_actions,lives,steps_per_life";
+                m_out << '\n';
+            }
+        }
+
+        bool isOpen() const {return static_cast<bool>(m_out);}
+
+        void writeGeneration(int generation, double averageFitness, const PhaseTimes& times, const SimulationCounters& counters)
+        {
+            double stepsPerLife {counters.lives == 0 ? 0.0 : static_cast<double>(counters.steps) / static_cast<double>(counters.lives)};
+
+            if (m_json)
+            {
+                m_out << "{\"generation\": " << generation << ", \"average_fitness\": " << averageFitness
+                      << ", \"seconds\": {\"evaluate\": " << times.evaluate << ", \"sort\": " << times.sort
+                      << ", \"cull\": " << times.cull << ", \"breed\": " << times.breed << "}";
+                if (STATS_ENABLED)
+                {
+                    m_out << ", \"counters\": {\"steps\": " << counters.steps << ", \"wall_bumps\": " << counters.wallBumps
+                          << ", \"battery_pickups\": " << counters.batteryPickups << ", \"random_actions\": " << counters.randomActions
+                          << ", \"lives\": " << counters.lives << ", \"steps_per_life\": " << stepsPerLife << "}";
+                }
+                m_out << "}\n";
+                return;
+            }
+
+            m_out << generation << ',' << averageFitness << ',' << times.evaluate << ',' << times.sort << ',' << times.cull << ',' << times.breed;
+            if (STATS_ENABLED)
+            {
+                m_out << ',' << counters.steps << ',' << counters.wallBumps << ',' << counters.batteryPickups << ','
+                      << counters.randomActions << ',' << counters.lives << ',' << stepsPerLife;
+            }
+            m_out << '\n';
+        }
+};
+
+#endif
@@ -0,0 +1,318 @@
+#ifndef STEADY_STATE_H
+#define STEADY_STATE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "evaluation_arena.h"
+#include "genetic_algorithm.h"
+#include "genome.h"
+#include "map.h"
+#include "population.h"
+#include "rng.h"
+#include "stats.h"
+
+// a genetic algorithm without generations, for --steady-state
+// every worker thread keeps breeding a few children from the shared population, simulates
+// them on its own and hands back the results, a child that beats the worst robot in the
+// population takes its place straight away, so a worker never waits for robots that
+// happen to live longer than the ones it was given
+//
+// the run is as long as the generational one with the same settings: the first
+// population and then half a population of children for every later generation, and
+// the average fitness is reported at the same points, so the two can be compared line
+// by line
+//
+// with more than one worker the order children come back in depends on thread timing,
+// so only a single worker repeats a run exactly
+struct SteadyStateSettings
+{
+    std::size_t workerCount {1};
+    std::size_t populationSize {200};
+    int generations {100};
+    // children a worker breeds and simulates between visits to the shared population
+    std::size_t batchSize {8};
+    std::size_t tournamentSize {2};
+    int mutationPercent {DEFAULT_MUTATION_PERCENT};
+    std::size_t trials {1};
+    bool batched {false};
+};
+
+// the population every worker breeds from and sends its children to
+// breeding and replacing are both O(log n) or better and happen under one lock, a
+// worker only takes it twice per batch, so the lock is never held for long
+template <std::size_t GeneCount>
+class SteadyStatePopulation
+{
+    private:
+        std::mutex m_mutex {};
+        std::vector<Genome<GeneCount>> m_genomes {};
+        std::vector<double> m_fitness {};
+        // the slots as a heap with the worst robot at the front
+        std::vector<std::size_t> m_worstFirst {};
+        double m_totalFitness {};
+
+        std::size_t m_capacity {};
+        std::size_t m_reportInterval {};
+        // robot lives handed out and results taken in so far, out of m_budget
+        std::size_t m_started {};
+        std::size_t m_finished {};
+        std::size_t m_budget {};
+        std::size_t m_kept {};
+        std::size_t m_dropped {};
+
+        std::vector<double> m_averageFitness {};
+        std::vector<double> m_bestFitness {};
+
+        HalfCrossover m_crossover {};
+        PointMutation m_mutator {};
+        std::size_t m_tournamentSize {2};
+
+        // lower fitness first, ties go to the higher slot
+        bool isWorse(std::size_t a, std::size_t b) const
+        {
+            return m_fitness[a] < m_fitness[b] || (m_fitness[a] == m_fitness[b] && a > b);
+        }
+
+        std::size_t pickParent(Rng& rng) const
+        {
+            std::size_t best {static_cast<std::size_t>(rng.nextInt(static_cast<int>(m_genomes.size())))};
+            for (std::size_t i {1}; i < m_tournamentSize; ++i)
+            {
+                std::size_t challenger {static_cast<std::size_t>(rng.nextInt(static_cast<int>(m_genomes.size())))};
+                if (isWorse(best, challenger))
+                    best = challenger;
+            }
+            return best;
+        }
+
+        void insert(const Genome<GeneCount>& genome, double fitness)
+        {
+            // the heap orders the worst robot first, so its comparison is reversed
+            auto worseLast = [this](std::size_t a, std::size_t b) {return isWorse(b, a);};
+
+            if (m_genomes.size() < m_capacity)
+            {
+                m_genomes.push_back(genome);
+                m_fitness.push_back(fitness);
+                m_worstFirst.push_back(m_genomes.size() - 1);
+                std::push_heap(m_worstFirst.begin(), m_worstFirst.end(), worseLast);
+                m_totalFitness += fitness;
+                ++m_kept;
+                return;
+            }
+
+            std::size_t worst {m_worstFirst.front()};
+            if (fitness <= m_fitness[worst])
+            {
+                ++m_dropped;
+                return;
+            }
+
+            std::pop_heap(m_worstFirst.begin(), m_worstFirst.end(), worseLast);
+            m_totalFitness += fitness - m_fitness[worst];
+            m_genomes[worst] = genome;
+            m_fitness[worst] = fitness;
+            std::push_heap(m_worstFirst.begin(), m_worstFirst.end(), worseLast);
+            ++m_kept;
+        }
+
+        void report()
+        {
+            m_averageFitness.push_back(m_totalFitness / static_cast<double>(m_fitness.size()));
+            m_bestFitness.push_back(*std::max_element(m_fitness.begin(), m_fitness.end()));
+        }
+    public:
+        explicit SteadyStatePopulation(const SteadyStateSettings& settings)
+        : m_capacity {settings.populationSize}
+        , m_reportInterval {std::max<std::size_t>(settings.populationSize / 2, 1)}
+        , m_budget {settings.populationSize + static_cast<std::size_t>(std::max(settings.generations - 1, 0)) * std::max<std::size_t>(settings.populationSize / 2, 1)}
+        , m_mutator {settings.mutationPercent}
+        , m_tournamentSize {std::max<std::size_t>(settings.tournamentSize, 1)}
+        {
+            m_genomes.reserve(m_capacity);
+            m_fitness.reserve(m_capacity);
+            m_worstFirst.reserve(m_capacity);
+        }
+
+        // fills children with up to count new genomes and returns how many, 0 once the
+        // whole run has been handed out
+        // the first population is random, after that every pair of children comes from two
+        // parents picked by tournament, a random genome fills in while fewer than two
+        // robots are back yet
+        std::size_t takeChildren(std::vector<Genome<GeneCount>>& children, std::size_t count, Rng& rng)
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            count = std::min(count, m_budget - m_started);
+            children.resize(count);
+
+            for (std::size_t i {0}; i < count; ++i)
+            {
+                if (m_started + i < m_capacity || m_genomes.size() < 2)
+                {
+                    children[i] = Genome<GeneCount>::random(rng);
+                    continue;
+                }
+
+                std::size_t a {pickParent(rng)};
+                std::size_t b {pickParent(rng)};
+                m_crossover(m_genomes[a], m_genomes[b], 0, children[i]);
+                m_mutator(children[i], rng);
+                if (++i == count)
+                    break;
+                m_crossover(m_genomes[a], m_genomes[b], 1, children[i]);
+                m_mutator(children[i], rng);
+            }
+
+            m_started += count;
+            return count;
+        }
+
+        // the scored children of one batch
+        template <typename Grid>
+        void giveResults(const Population<Grid, GeneCount>& children)
+        {
+            std::lock_guard<std::mutex> lock {m_mutex};
+            for (std::size_t i {0}; i < children.size(); ++i)
+            {
+                insert(children.getGenome(i), children.getFitness(i));
+                ++m_finished;
+
+                // a generation's worth of lives has been run, counting the first population as one
+                if (m_finished >= m_capacity && (m_finished - m_capacity) % m_reportInterval == 0)
+                    report();
+            }
+        }
+
+        // read once the workers are done
+        std::size_t getReportCount() const {return m_averageFitness.size();}
+        double getAverageFitness(std::size_t report) const {return m_averageFitness[report];}
+        double getBestFitness(std::size_t report) const {return m_bestFitness[report];}
+        std::size_t getEvaluations() const {return m_finished;}
+        std::size_t getKept() const {return m_kept;}
+        std::size_t getDropped() const {return m_dropped;}
+};
+
+// the workers and the population they share
+template <typename Grid, std::size_t GeneCount>
+class SteadyStateModel
+{
+    private:
+        struct Worker
+        {
+            Rng rng;
+            LayoutSource<Grid> layouts;
+            EvaluationArena<Grid, GeneCount> arena;
+            Population<Grid, GeneCount> children {};
+            std::vector<Genome<GeneCount>> genomes {};
+            double simulateSeconds {};
+            SimulationCounters counters {};
+
+            Worker(const Grid& grid, std::uint32_t seed, const std::vector<std::uint32_t>& sharedSeeds)
+            : rng {seed}
+            , layouts {grid, sharedSeeds}
+            , arena {grid}
+            {
+                children.returnLayoutsTo(layouts);
+            }
+        };
+
+        SteadyStateSettings m_settings {};
+        SteadyStatePopulation<GeneCount> m_population;
+        std::vector<std::unique_ptr<Worker>> m_workers {};
+        double m_seconds {};
+
+        void runWorker(Worker& worker)
+        {
+            while (m_population.takeChildren(worker.genomes, m_settings.batchSize, worker.rng) > 0)
+            {
+                // the batch is cleared first so its layouts can be used again
+                worker.children.truncate(0);
+                for (const Genome<GeneCount>& genome : worker.genomes)
+                {
+                    worker.children.getGenome(worker.children.addRobot(worker.layouts.nextLayout(worker.rng), worker.rng)) = genome;
+                }
+
+                PhaseTimer timer {};
+                if (m_settings.batched)
+                    worker.arena.evaluateRangeBatched(worker.children, 0, worker.children.size(), worker.layouts, m_settings.trials, worker.rng);
+                else
+                    worker.arena.evaluateRange(worker.children, 0, worker.children.size(), worker.layouts, m_settings.trials, worker.rng);
+                worker.simulateSeconds += timer.lap();
+
+                m_population.giveResults(worker.children);
+            }
+            worker.arena.takeCounters(worker.counters);
+        }
+    public:
+        // every worker is seeded from rng, shared layouts are rebuilt by each worker from
+        // the same seeds so they never have to share a layout source
+        SteadyStateModel(const Grid& grid, const SteadyStateSettings& settings, const std::vector<std::uint32_t>& sharedSeeds, Rng& rng)
+        : m_settings {settings}
+        , m_population {settings}
+        {
+            std::size_t workerCount {settings.workerCount};
+            if (workerCount == 0)
+                workerCount = std::thread::hardware_concurrency();
+            if (workerCount == 0)
+                workerCount = 1;
+
+            for (std::size_t i {0}; i < workerCount; ++i)
+            {
+                m_workers.push_back(std::make_unique<Worker>(grid, rng.nextSeed(), sharedSeeds));
+            }
+        }
+
+        // run every worker on its own thread until the whole run is handed out and back
+        void run()
+        {
+            PhaseTimer timer {};
+
+            std::vector<std::thread> threads {};
+            threads.reserve(m_workers.size());
+            for (std::unique_ptr<Worker>& worker : m_workers)
+            {
+                threads.emplace_back(&SteadyStateModel::runWorker, this, std::ref(*worker));
+            }
+
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+            m_seconds = timer.lap();
+        }
+
+        const SteadyStatePopulation<GeneCount>& getPopulation() const {return m_population;}
+        std::size_t size() const {return m_workers.size();}
+        double getSeconds() const {return m_seconds;}
+
+        // how much of the workers' time went into simulating robots, from 0 to 1
+        double getSimulatingShare() const
+        {
+            double simulating {};
+            for (const std::unique_ptr<Worker>& worker : m_workers)
+            {
+                simulating += worker->simulateSeconds;
+            }
+            double available {m_seconds * static_cast<double>(m_workers.size())};
+            return available > 0.0 ? simulating / available : 0.0;
+        }
+
+        SimulationCounters getCounters() const
+        {
+            SimulationCounters counters {};
+            for (const std::unique_ptr<Worker>& worker : m_workers)
+            {
+                counters += worker->counters;
+            }
+            return counters;
+        }
+};
+
+#endif
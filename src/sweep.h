@@ -0,0 +1,412 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "counter_rng.h"
+#include "genetic_algorithm.h"
+#include "genetic_engine.h"
+#include "genome.h"
+#include "grid.h"
+#include "map.h"
+#include "population.h"
+#include "rng.h"
+#include "selection.h"
+
+// many runs of the genetic algorithm from one file, for --sweep
+//
+// every line of a sweep file is a setting followed by the values to try, and the sweep
+// runs every combination of them once for every seed:
+//
+//     # 3 x 2 configurations x 5 seeds = 30 runs
+//     population 100 200 400
+//     mutation 2 5
+//     seeds 1-5
+//
+// a line starting with "config" is one configuration given in full instead, every config
+// line is run against every combination of the other lines:
+//
+//     config population=200 grid=10x10 batteries=40
+//     config population=800 grid=20x20 batteries=30
+//
+// anything not set in the file is taken from the command line, --seed included
+//
+// the settings are population, generations, mutation (percent), grid (WxH), batteries
+// (percent), genes, trials, layouts, selection, tournament-size and rank-pressure
+
+// everything one run of a sweep needs
+struct SweepConfig
+{
+    std::uint32_t seed {};
+    std::size_t populationSize {200};
+    int generations {100};
+    int mutationPercent {DEFAULT_MUTATION_PERCENT};
+    int width {DefaultGrid::width()};
+    int height {DefaultGrid::height()};
+    int batteryPercent {DefaultGrid::batteryPercent()};
+    std::size_t geneCount {DEFAULT_GENE_COUNT};
+    std::size_t trials {1};
+    std::size_t sharedLayoutCount {0};
+    SelectionSettings selection {};
+    bool batched {false};
+
+    // roughly how long the run takes compared to the others, robot lives times grid size
+    double estimatedCost() const
+    {
+        return static_cast<double>(populationSize) * generations * static_cast<double>(trials) * width * height;
+    }
+};
+
+// how one run went, one entry per generation
+struct SweepCurve
+{
+    std::vector<double> averageFitness {};
+    std::vector<double> bestFitness {};
+};
+
+// the runs of a sweep file, check getError() if load() fails
+class SweepPlan
+{
+    private:
+        std::vector<SweepConfig> m_jobs {};
+        std::string m_error {};
+
+        // false if the setting does not exist or the value does not fit it
+        static bool applySetting(SweepConfig& config, const std::string& key, const std::string& value)
+        {
+            try
+            {
+                if (key == "population")
+                {
+                    config.populationSize = static_cast<std::size_t>(std::stoul(value));
+                    return isValidPopulationSize(config.populationSize);
+                }
+                if (key == "generations")
+                {
+                    config.generations = std::stoi(value);
+                    return config.generations >= 1;
+                }
+                if (key == "mutation")
+                {
+                    config.mutationPercent = std::stoi(value);
+                    return config.mutationPercent >= 0 && config.mutationPercent <= 100;
+                }
+                if (key == "grid")
+                {
+                    std::size_t separator {value.find('x')};
+                    if (separator == std::string::npos)
+                        return false;
+                    config.width = std::stoi(value.substr(0, separator));
+                    config.height = std::stoi(value.substr(separator + 1));
+                    return config.width >= 1 && config.height >= 1;
+                }
+                if (key == "batteries")
+                {
+                    config.batteryPercent = std::stoi(value);
+                    return config.batteryPercent >= 0 && config.batteryPercent <= 99;
+                }
+                if (key == "genes")
+                {
+                    config.geneCount = static_cast<std::size_t>(std::stoul(value));
+                    return config.geneCount == 8 || config.geneCount == 16 || config.geneCount == 32;
+                }
+                if (key == "trials")
+                {
+                    config.trials = static_cast<std::size_t>(std::stoul(value));
+                    return config.trials >= 1;
+                }
+                if (key == "layouts")
+                {
+                    config.sharedLayoutCount = static_cast<std::size_t>(std::stoul(value));
+                    return true;
+                }
+                if (key == "selection")
+                {
+                    return parseSelectionScheme(value, config.selection.scheme);
+                }
+                if (key == "tournament-size")
+                {
+                    config.selection.tournamentSize = static_cast<std::size_t>(std::stoul(value));
+                    return config.selection.tournamentSize >= 1;
+                }
+                if (key == "rank-pressure")
+                {
+                    config.selection.rankPressure = std::stod(value);
+                    return config.selection.rankPressure >= 1.0 && config.selection.rankPressure <= 2.0;
+                }
+            }
+            catch (const std::exception&)
+            {
+                // not a number
+            }
+            return false;
+        }
+
+        // a single seed or an inclusive range like 1-20
+        static bool addSeeds(const std::string& value, std::vector<std::uint32_t>& seeds)
+        {
+            try
+            {
+                std::size_t separator {value.find('-')};
+                std::uint32_t first {static_cast<std::uint32_t>(std::stoul(value.substr(0, separator)))};
+                std::uint32_t last {separator == std::string::npos ? first : static_cast<std::uint32_t>(std::stoul(value.substr(separator + 1)))};
+                if (last < first)
+                    return false;
+
+                for (std::uint32_t seed {first}; ; ++seed)
+                {
+                    seeds.push_back(seed);
+                    if (seed == last)
+                        break;
+                }
+                return true;
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+        }
+
+        bool fail(const std::string& error)
+        {
+            m_error = error;
+            m_jobs.clear();
+            return false;
+        }
+    public:
+        // every combination in the file, seeds last, settings it leaves out come from base
+        bool load(const std::string& path, const SweepConfig& base)
+        {
+            std::ifstream in {path};
+            if (!in)
+                return fail("Could not open " + path);
+
+            std::vector<SweepConfig> configs {};
+            std::vector<std::string> configKeys {};
+            std::vector<std::pair<std::string, std::vector<std::string>>> settings {};
+            std::vector<std::uint32_t> seeds {};
+
+            std::string line {};
+            for (int lineNumber {1}; std::getline(in, line); ++lineNumber)
+            {
+                std::string where {path + " line " + std::to_string(lineNumber) + ": "};
+
+                std::size_t comment {line.find('#')};
+                if (comment != std::string::npos)
+                    line.erase(comment);
+
+                std::istringstream words {line};
+                std::string key {};
+                if (!(words >> key))
+                    continue;
+
+                std::vector<std::string> values {};
+                std::string value {};
+                while (words >> value)
+                {
+                    values.push_back(value);
+                }
+                if (values.empty())
+                    return fail(where + key + " has no values");
+
+                if (key == "seeds")
+                {
+                    for (const std::string& seed : values)
+                    {
+                        if (!addSeeds(seed, seeds))
+                            return fail(where + seed + " is not a seed or a range of seeds");
+                    }
+                }
+                else if (key == "config")
+                {
+                    SweepConfig config {base};
+                    for (const std::string& setting : values)
+                    {
+                        std::size_t equals {setting.find('=')};
+                        if (equals == std::string::npos || !applySetting(config, setting.substr(0, equals), setting.substr(equals + 1)))
+                            return fail(where + setting + " is not a setting=value this build understands");
+                        configKeys.push_back(setting.substr(0, equals));
+                    }
+                    configs.push_back(config);
+                }
+                else
+                {
+                    SweepConfig check {base};
+                    for (const std::string& setting : values)
+                    {
+                        if (!applySetting(check, key, setting))
+                        {
+                            if (key == "population")
+                                return fail(where + setting + " is not a value for population, it needs a multiple of 4 robots");
+                            return fail(where + setting + " is not a value for " + key);
+                        }
+                    }
+                    for (const std::pair<std::string, std::vector<std::string>>& setting : settings)
+                    {
+                        if (setting.first == key)
+                            return fail(where + key + " is set twice");
+                    }
+                    settings.emplace_back(key, values);
+                }
+            }
+
+            // a setting can't be swept and fixed by a config line at the same time
+            for (const std::pair<std::string, std::vector<std::string>>& setting : settings)
+            {
+                if (std::find(configKeys.begin(), configKeys.end(), setting.first) != configKeys.end())
+                    return fail(path + ": " + setting.first + " is set on a config line and on a line of its own");
+            }
+
+            if (configs.empty())
+                configs.push_back(base);
+            if (seeds.empty())
+                seeds.push_back(base.seed);
+
+            for (const std::pair<std::string, std::vector<std::string>>& setting : settings)
+            {
+                std::vector<SweepConfig> combined {};
+                combined.reserve(configs.size() * setting.second.size());
+                for (const SweepConfig& config : configs)
+                {
+                    for (const std::string& value : setting.second)
+                    {
+                        combined.push_back(config);
+                        applySetting(combined.back(), setting.first, value);
+                    }
+                }
+                configs = std::move(combined);
+            }
+
+            m_jobs.clear();
+            m_jobs.reserve(configs.size() * seeds.size());
+            for (const SweepConfig& config : configs)
+            {
+                for (std::uint32_t seed : seeds)
+                {
+                    m_jobs.push_back(config);
+                    m_jobs.back().seed = seed;
+                }
+            }
+            return true;
+        }
+
+        const std::string& getError() const {return m_error;}
+        std::size_t size() const {return m_jobs.size();}
+        const SweepConfig& getJob(std::size_t i) const {return m_jobs[i];}
+
+        // the longest runs first so the short ones fill in around them at the end
+        std::vector<std::size_t> longestFirst() const
+        {
+            std::vector<std::size_t> order(m_jobs.size());
+            for (std::size_t i {0}; i < order.size(); ++i)
+            {
+                order[i] = i;
+            }
+            std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+                return m_jobs[a].estimatedCost() > m_jobs[b].estimatedCost();
+            });
+            return order;
+        }
+};
+
+// one run on the calling thread, the same run main() does with these settings
+template <typename Grid, std::size_t GeneCount>
+SweepCurve runSweepJob(const SweepConfig& config, const Grid& grid)
+{
+    using Engine = GeneticEngine<Genome<GeneCount>, ArenaEvaluator<Grid, GeneCount>, Selector, HalfCrossover, PointMutation>;
+
+    Rng rng {config.seed};
+    LayoutSource<Grid> layouts {grid, config.sharedLayoutCount, rng};
+    Population<Grid, GeneCount> robots {config.populationSize, layouts, rng};
+    robots.returnLayoutsTo(layouts);
+
+    Engine engine {ArenaEvaluator<Grid, GeneCount> {grid, CounterRng {config.seed}, layouts, config.trials, config.batched}, Selector {config.selection}, HalfCrossover {}, PointMutation {config.mutationPercent}};
+
+    SweepCurve curve {};
+    curve.averageFitness.reserve(static_cast<std::size_t>(config.generations));
+    curve.bestFitness.reserve(static_cast<std::size_t>(config.generations));
+
+    for (int generation {0}; generation < config.generations; ++generation)
+    {
+        engine.evaluate(robots);
+
+        double totalFitness {};
+        double bestFitness {robots.getFitness(0)};
+        for (std::size_t i {0}; i < robots.size(); ++i)
+        {
+            totalFitness += robots.getFitness(i);
+            bestFitness = std::max(bestFitness, robots.getFitness(i));
+        }
+        curve.averageFitness.push_back(totalFitness / static_cast<double>(robots.size()));
+        curve.bestFitness.push_back(bestFitness);
+
+        engine.select(robots, rng);
+        engine.breed(robots, rng);
+    }
+
+    return curve;
+}
+
+template <typename Grid>
+SweepCurve runSweepJobWithGeneCount(const SweepConfig& config, const Grid& grid)
+{
+    switch (config.geneCount)
+    {
+    case 8:
+        return runSweepJob<Grid, 8>(config, grid);
+    case 32:
+        return runSweepJob<Grid, 32>(config, grid);
+    default:
+        return runSweepJob<Grid, DEFAULT_GENE_COUNT>(config, grid);
+    }
+}
+
+// picks the compiled grid and gene count the same way main() does
+inline SweepCurve runSweepConfig(const SweepConfig& config)
+{
+    if (config.width == DefaultGrid::width() && config.height == DefaultGrid::height() && config.batteryPercent == DefaultGrid::batteryPercent())
+        return runSweepJobWithGeneCount(config, DefaultGrid {});
+
+    return runSweepJobWithGeneCount(config, DynamicGrid {config.width, config.height, config.batteryPercent});
+}
+
+// every generation of every run as one CSV row, the runs in the order of the sweep file
+class SweepResultsWriter
+{
+    private:
+        std::ofstream m_out {};
+    public:
+        explicit SweepResultsWriter(const std::string& path)
+        : m_out {path}
+        {
+            if (m_out)
+            {
+                m_out << "job,seed,population,generations,mutation_percent,grid,battery_percent,genes,trials,layouts,selection,tournament_size,rank_pressure,"
+                      << "generation,average_fitness,best_fitness\n";
+            }
+        }
+
+        bool isOpen() const {return static_cast<bool>(m_out);}
+
+        void writeJob(std::size_t job, const SweepConfig& config, const SweepCurve& curve)
+        {
+            for (std::size_t generation {0}; generation < curve.averageFitness.size(); ++generation)
+            {
+                m_out << job << ',' << config.seed << ',' << config.populationSize << ',' << config.generations << ',' << config.mutationPercent << ','
+                      << config.width << 'x' << config.height << ',' << config.batteryPercent << ',' << config.geneCount << ',' << config.trials << ','
+                      << config.sharedLayoutCount << ',' << selectionSchemeName(config.selection.scheme) << ',' << config.selection.tournamentSize << ','
+                      << config.selection.rankPressure << ',' << generation << ',' << curve.averageFitness[generation] << ',' << curve.bestFitness[generation] << '\n';
+            }
+            m_out.flush();
+        }
+};
+
+#endif
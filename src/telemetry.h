@@ -0,0 +1,294 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+// output of a run, written by a background thread so the generation loop never waits on
+// the console or the disk unless it gets a whole ring of blocks ahead of it
+//
+// the main thread fills one block at a time, a full block is handed to the writer thread
+// and the main thread moves on to the next block in the ring, only waiting if that one
+// has not been written out yet
+//
+// on the console or a terminal endGeneration() hands over whatever is in the block at
+// the end of every generation, so every line shows up as soon as its generation is done
+// like it always has, a file only gets whole blocks
+//
+// text mode prints the same lines main() always has, binary mode writes a small file
+// header followed by fixed size records, see the structs below
+
+constexpr char TELEMETRY_MAGIC[8] {'G', 'A', 'T', 'E', 'L', 'E', 'M', '\0'};
+constexpr std::uint32_t TELEMETRY_VERSION {1};
+
+enum TelemetryRecordType : std::uint32_t
+{
+    GenerationRecordType = 1,
+    RobotRecordType = 2,
+};
+
+// one per generation, averaged over the population
+struct GenerationRecord
+{
+    std::uint32_t type;
+    std::uint32_t generation;
+    std::uint32_t robotCount;
+    std::uint32_t trials;
+    double meanFitness;
+    double meanFitnessMin;
+    double meanFitnessVariance;
+};
+
+// one per robot per generation, only written when robots are logged
+struct RobotRecord
+{
+    std::uint32_t type;
+    std::uint32_t generation;
+    std::uint32_t index;
+    std::int32_t fitnessMin;
+    double fitness;
+    double fitnessVariance;
+    std::int32_t powerHarvested;
+    std::int32_t turnsSurvived;
+};
+
+class TelemetryWriter
+{
+    public:
+        enum class Format
+        {
+            Text,
+            Binary,
+        };
+    private:
+        static constexpr std::size_t BLOCK_SIZE {64 * 1024};
+        static constexpr std::size_t BLOCK_COUNT {8};
+
+        std::FILE* m_out {nullptr};
+        bool m_ownsFile {false};
+        Format m_format {Format::Text};
+        // hand over every generation and flush every block, for someone watching the run
+        bool m_eachGeneration {false};
+
+        std::vector<std::vector<char>> m_blocks {};
+        // the block the main thread is filling and the next block the writer will drain
+        std::size_t m_fillBlock {};
+        std::size_t m_drainBlock {};
+        // blocks handed to the writer and not written yet
+        std::size_t m_pending {};
+        bool m_closing {false};
+
+        std::mutex m_mutex {};
+        std::condition_variable m_blockReady {};
+        std::condition_variable m_blockFree {};
+        std::thread m_thread {};
+
+        void writerLoop()
+        {
+            std::unique_lock<std::mutex> lock {m_mutex};
+            while (true)
+            {
+                m_blockReady.wait(lock, [this] {return m_pending > 0 || m_closing;});
+                if (m_pending == 0)
+                    return;
+
+                // the main thread never touches a pending block, so it is written unlocked
+                std::vector<char>& block {m_blocks[m_drainBlock]};
+                lock.unlock();
+                std::fwrite(block.data(), 1, block.size(), m_out);
+                if (m_eachGeneration)
+                    std::fflush(m_out);
+                block.clear();
+                lock.lock();
+
+                m_drainBlock = (m_drainBlock + 1) % BLOCK_COUNT;
+                --m_pending;
+                m_blockFree.notify_all();
+            }
+        }
+
+        // hand the current block to the writer and wait for the next one to be free
+        void submitBlock()
+        {
+            std::unique_lock<std::mutex> lock {m_mutex};
+            ++m_pending;
+            m_fillBlock = (m_fillBlock + 1) % BLOCK_COUNT;
+            m_blockReady.notify_one();
+            m_blockFree.wait(lock, [this] {return m_pending < BLOCK_COUNT;});
+        }
+
+        void append(const char* data, std::size_t size)
+        {
+            // nowhere to write to, see isOpen()
+            if (!m_out)
+                return;
+
+            while (size > 0)
+            {
+                std::vector<char>& block {m_blocks[m_fillBlock]};
+                std::size_t count {std::min(size, BLOCK_SIZE - block.size())};
+                block.insert(block.end(), data, data + count);
+                data += count;
+                size -= count;
+
+                if (block.size() == BLOCK_SIZE)
+                    submitBlock();
+            }
+        }
+
+        template <typename Record>
+        void appendRecord(const Record& record)
+        {
+            char bytes[sizeof(Record)];
+            std::memcpy(bytes, &record, sizeof(Record));
+            append(bytes, sizeof(Record));
+        }
+
+        // doubles are printed like std::cout prints them by default
+        static std::string formatNumber(double value)
+        {
+            char text[32];
+            std::snprintf(text, sizeof(text), "%g", value);
+            return text;
+        }
+
+        void start()
+        {
+            m_blocks.resize(BLOCK_COUNT);
+            for (std::vector<char>& block : m_blocks)
+            {
+                block.reserve(BLOCK_SIZE);
+            }
+
+            if (m_format == Format::Binary && m_out)
+            {
+                char header[16] {};
+                std::memcpy(header, TELEMETRY_MAGIC, sizeof(TELEMETRY_MAGIC));
+                std::memcpy(header + 8, &TELEMETRY_VERSION, sizeof(TELEMETRY_VERSION));
+                append(header, sizeof(header));
+            }
+
+            if (m_out)
+            {
+                m_eachGeneration = m_out == stdout || ::isatty(::fileno(m_out));
+                m_thread = std::thread {&TelemetryWriter::writerLoop, this};
+            }
+        }
+    public:
+        // write to the console
+        explicit TelemetryWriter(Format format = Format::Text)
+        : m_out {stdout}
+        , m_format {format}
+        {
+            start();
+        }
+
+        // write to a file, check isOpen() afterwards
+        TelemetryWriter(const std::string& path, Format format)
+        : m_out {std::fopen(path.c_str(), format == Format::Binary ? "wb" : "w")}
+        , m_ownsFile {true}
+        , m_format {format}
+        {
+            start();
+        }
+
+        TelemetryWriter(const TelemetryWriter&) = delete;
+        TelemetryWriter& operator=(const TelemetryWriter&) = delete;
+
+        ~TelemetryWriter()
+        {
+            if (!m_out)
+                return;
+
+            flush();
+            {
+                std::lock_guard<std::mutex> lock {m_mutex};
+                m_closing = true;
+            }
+            m_blockReady.notify_one();
+            m_thread.join();
+
+            if (m_ownsFile)
+                std::fclose(m_out);
+        }
+
+        bool isOpen() const {return m_out != nullptr;}
+        Format getFormat() const {return m_format;}
+
+        // the line printed after every generation, plus the trials line when there are trials
+        void writeGeneration(const GenerationRecord& record)
+        {
+            if (m_format == Format::Binary)
+            {
+                GenerationRecord typed {record};
+                typed.type = GenerationRecordType;
+                appendRecord(typed);
+                return;
+            }
+
+            std::string text {"The Average Fitness Score for Generation #" + std::to_string(record.generation) + ": " + std::to_string(static_cast<int>(record.meanFitness)) + '\n'};
+            if (record.trials > 1)
+            {
+                text += "    Trials: " + std::to_string(record.trials) + ", Mean: " + formatNumber(record.meanFitness) + ", Min: " + formatNumber(record.meanFitnessMin)
+                        + ", Variance: " + formatNumber(record.meanFitnessVariance) + '\n';
+            }
+            append(text.data(), text.size());
+        }
+
+        void writeRobot(const RobotRecord& record)
+        {
+            if (m_format == Format::Binary)
+            {
+                RobotRecord typed {record};
+                typed.type = RobotRecordType;
+                appendRecord(typed);
+                return;
+            }
+
+            std::string text {"    Robot " + std::to_string(record.index) + ": Fitness: " + formatNumber(record.fitness) + ", Min: " + std::to_string(record.fitnessMin)
+                              + ", Variance: " + formatNumber(record.fitnessVariance) + ", Power Harvested: " + std::to_string(record.powerHarvested)
+                              + ", Turns Survived: " + std::to_string(record.turnsSurvived) + '\n'};
+            append(text.data(), text.size());
+        }
+
+        // free form lines, only written in text mode
+        void writeText(const std::string& text)
+        {
+            if (m_format == Format::Text)
+                append(text.data(), text.size());
+        }
+
+        // call once a generation's lines are all written, see m_eachGeneration
+        // the lines are handed over without waiting for them to be written
+        void endGeneration()
+        {
+            if (m_out && m_eachGeneration && !m_blocks[m_fillBlock].empty())
+                submitBlock();
+        }
+
+        // wait until everything written so far is out of the process
+        void flush()
+        {
+            if (!m_out)
+                return;
+
+            if (!m_blocks[m_fillBlock].empty())
+                submitBlock();
+
+            std::unique_lock<std::mutex> lock {m_mutex};
+            m_blockFree.wait(lock, [this] {return m_pending == 0;});
+            std::fflush(m_out);
+        }
+};
+
+#endif
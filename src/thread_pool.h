@@ -0,0 +1,116 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed size pool of worker threads
+// work is handed out as contiguous ranges, one range per worker, so the same worker
+// always gets the same part of the population for a given thread count
+class ThreadPool
+{
+    public:
+        // begin index, end index, worker index
+        using RangeTask = std::function<void(std::size_t, std::size_t, std::size_t)>;
+    private:
+        std::vector<std::thread> m_workers {};
+        std::mutex m_mutex {};
+        std::condition_variable m_startCondition {};
+        std::condition_variable m_doneCondition {};
+        const RangeTask* m_task {nullptr};
+        std::size_t m_count {};
+        std::size_t m_generation {};
+        std::size_t m_busyWorkers {};
+        bool m_stopping {false};
+
+        void workerLoop(std::size_t workerIndex)
+        {
+            std::size_t seenGeneration {0};
+
+            while (true)
+            {
+                const RangeTask* task {nullptr};
+                std::size_t count {};
+                {
+                    std::unique_lock<std::mutex> lock {m_mutex};
+                    m_startCondition.wait(lock, [&] { return m_stopping || m_generation != seenGeneration; });
+
+                    if (m_stopping)
+                        return;
+
+                    seenGeneration = m_generation;
+                    task = m_task;
+                    count = m_count;
+                }
+
+                std::size_t begin {(count * workerIndex) / m_workers.size()};
+                std::size_t end {(count * (workerIndex + 1)) / m_workers.size()};
+
+                if (begin < end)
+                    (*task)(begin, end, workerIndex);
+
+                {
+                    std::lock_guard<std::mutex> lock {m_mutex};
+                    --m_busyWorkers;
+                }
+                m_doneCondition.notify_one();
+            }
+        }
+    public:
+        // 0 threads means use every core on the machine
+        explicit ThreadPool(std::size_t threadCount)
+        {
+            if (threadCount == 0)
+                threadCount = std::thread::hardware_concurrency();
+            if (threadCount == 0)
+                threadCount = 1;
+
+            m_workers.reserve(threadCount);
+            for (std::size_t i {0}; i < threadCount; ++i)
+            {
+                m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock {m_mutex};
+                m_stopping = true;
+            }
+            m_startCondition.notify_all();
+
+            for (std::thread& worker : m_workers)
+            {
+                worker.join();
+            }
+        }
+
+        std::size_t size() const {return m_workers.size();}
+
+        // split [0, count) between the workers and block until every range is finished
+        void parallelFor(std::size_t count, const RangeTask& task)
+        {
+            {
+                std::lock_guard<std::mutex> lock {m_mutex};
+                m_task = &task;
+                m_count = count;
+                m_busyWorkers = m_workers.size();
+                ++m_generation;
+            }
+            m_startCondition.notify_all();
+
+            std::unique_lock<std::mutex> lock {m_mutex};
+            m_doneCondition.wait(lock, [&] { return m_busyWorkers == 0; });
+            m_task = nullptr;
+        }
+};
+
+#endif
@@ -0,0 +1,291 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "evaluation_set.h"
+#include "genome.h"
+#include "map.h"
+#include "population.h"
+#include "rng.h"
+#include "robot.h"
+#include "stats.h"
+
+// recorded robot lives for --record, read back by the replay tool
+//
+// a life is stored as the layout seed, the spawn spot and one 3 bit code per step:
+// 0-3 is a move the genes asked for and 4-7 is a random move that went in direction
+// code - 4, so a replay needs neither the genes nor the random state
+//
+// the file is a small header followed by one record per life, each record is followed
+// by the robot's genome words and then its packed steps, numbers are stored in the
+// machine's own byte order
+
+constexpr char TRAJECTORY_MAGIC[8] {'G', 'A', 'T', 'R', 'A', 'J', '\0', '\0'};
+constexpr std::uint32_t TRAJECTORY_VERSION {1};
+
+struct TrajectoryFileHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t geneCount;
+    std::int32_t width;
+    std::int32_t height;
+    std::int32_t batteryPercent;
+    std::uint32_t wordsPerGenome;
+};
+
+struct TrajectoryRecord
+{
+    std::uint32_t generation;
+    std::uint32_t robot;
+    std::uint32_t layoutSeed;
+    std::int32_t spawnX;
+    std::int32_t spawnY;
+    std::int32_t powerHarvested;
+    std::int32_t turnsSurvived;
+    std::uint32_t stepCount;
+    double fitness;
+};
+
+// the steps of one life, 3 bits each
+class ActionLog
+{
+    private:
+        std::vector<std::uint8_t> m_bytes {};
+        std::size_t m_count {};
+    public:
+        static constexpr std::size_t BITS_PER_STEP {3};
+
+        static std::size_t byteCount(std::size_t steps) {return (steps * BITS_PER_STEP + 7) / 8;}
+
+        void clear()
+        {
+            m_bytes.clear();
+            m_count = 0;
+        }
+
+        void recordStep(bool random, int direction)
+        {
+            unsigned code {static_cast<unsigned>(direction) | (random ? 4u : 0u)};
+            std::size_t bit {m_count * BITS_PER_STEP};
+            m_bytes.resize(byteCount(m_count + 1));
+
+            m_bytes[bit / 8] = static_cast<std::uint8_t>(m_bytes[bit / 8] | (code << (bit % 8)));
+            // a code can spill over into the next byte
+            if (bit % 8 > 8 - BITS_PER_STEP)
+                m_bytes[bit / 8 + 1] = static_cast<std::uint8_t>(m_bytes[bit / 8 + 1] | (code >> (8 - bit % 8)));
+            ++m_count;
+        }
+
+        // load steps packed by recordStep()
+        void assign(const std::uint8_t* bytes, std::size_t steps)
+        {
+            m_bytes.assign(bytes, bytes + byteCount(steps));
+            m_count = steps;
+        }
+
+        std::size_t size() const {return m_count;}
+        const std::vector<std::uint8_t>& getBytes() const {return m_bytes;}
+
+        int direction(std::size_t step) const {return static_cast<int>(code(step) & 3u);}
+        bool isRandom(std::size_t step) const {return (code(step) & 4u) != 0;}
+
+        unsigned code(std::size_t step) const
+        {
+            std::size_t bit {step * BITS_PER_STEP};
+            unsigned value {static_cast<unsigned>(m_bytes[bit / 8]) >> (bit % 8)};
+            if (bit % 8 > 8 - BITS_PER_STEP)
+                value |= static_cast<unsigned>(m_bytes[bit / 8 + 1]) << (8 - bit % 8);
+            return value & 7u;
+        }
+};
+
+// one life read back from a file
+template <std::size_t GeneCount>
+struct Trajectory
+{
+    TrajectoryRecord record {};
+    Genome<GeneCount> genome {};
+    ActionLog steps {};
+};
+
+class TrajectoryWriter
+{
+    private:
+        std::ofstream m_out {};
+    public:
+        template <typename Grid>
+        TrajectoryWriter(const std::string& path, const Grid& grid, std::size_t geneCount)
+        : m_out {path, std::ios::binary}
+        {
+            TrajectoryFileHeader header {};
+            std::memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC));
+            header.version = TRAJECTORY_VERSION;
+            header.geneCount = static_cast<std::uint32_t>(geneCount);
+            header.width = grid.width();
+            header.height = grid.height();
+            header.batteryPercent = grid.batteryPercent();
+            header.wordsPerGenome = static_cast<std::uint32_t>(geneCount * GENE_BITS / 64);
+            m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+
+        bool isOpen() const {return static_cast<bool>(m_out);}
+
+        template <std::size_t GeneCount>
+        void write(const TrajectoryRecord& record, const Genome<GeneCount>& genome, const ActionLog& steps)
+        {
+            m_out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+            m_out.write(reinterpret_cast<const char*>(genome.getWords().data()), static_cast<std::streamsize>(sizeof(std::uint64_t) * Genome<GeneCount>::WORD_COUNT));
+            m_out.write(reinterpret_cast<const char*>(steps.getBytes().data()), static_cast<std::streamsize>(steps.getBytes().size()));
+        }
+
+        void flush() {m_out.flush();}
+};
+
+// reads a whole trajectory file, check getError() if open() fails
+class TrajectoryReader
+{
+    private:
+        TrajectoryFileHeader m_header {};
+        std::ifstream m_in {};
+        std::string m_error {};
+    public:
+        bool open(const std::string& path)
+        {
+            m_in.open(path, std::ios::binary);
+            if (!m_in)
+            {
+                m_error = "Could not open " + path;
+                return false;
+            }
+
+            if (!m_in.read(reinterpret_cast<char*>(&m_header), sizeof(m_header)) || std::memcmp(m_header.magic, TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC)) != 0)
+            {
+                m_error = path + " is not a trajectory file";
+                return false;
+            }
+            if (m_header.version != TRAJECTORY_VERSION)
+            {
+                m_error = path + " is trajectory version " + std::to_string(m_header.version) + ", this build reads version " + std::to_string(TRAJECTORY_VERSION);
+                return false;
+            }
+            return true;
+        }
+
+        const TrajectoryFileHeader& header() const {return m_header;}
+        const std::string& getError() const {return m_error;}
+
+        // the next life in the file, false at the end
+        template <std::size_t GeneCount>
+        bool next(Trajectory<GeneCount>& trajectory)
+        {
+            std::uint64_t words[Genome<GeneCount>::WORD_COUNT];
+            if (!m_in.read(reinterpret_cast<char*>(&trajectory.record), sizeof(TrajectoryRecord))
+                || !m_in.read(reinterpret_cast<char*>(words), sizeof(words)))
+                return false;
+
+            std::vector<std::uint8_t> bytes(ActionLog::byteCount(trajectory.record.stepCount));
+            if (!m_in.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size())))
+                return false;
+
+            trajectory.genome = Genome<GeneCount>::fromWords(words);
+            trajectory.steps.assign(bytes.data(), trajectory.record.stepCount);
+            return true;
+        }
+};
+
+// which robots to record each generation
+struct RecordSettings
+{
+    // the best this many robots
+    std::size_t topCount {0};
+    // and these robots by their index in the population
+    std::vector<std::size_t> robots {};
+};
+
+// runs the first trial of the chosen robots again one step at a time and writes their lives
+// this happens after evaluation and only for the chosen robots, the evaluation itself
+// never knows about it
+template <typename Grid, std::size_t GeneCount>
+class TrajectoryRecorder
+{
+    private:
+        RecordSettings m_settings {};
+        TrajectoryWriter& m_writer;
+        std::vector<std::size_t> m_chosen {};
+        ActionLog m_steps {};
+
+        void choose(const Population<Grid, GeneCount>& robots)
+        {
+            m_chosen.resize(robots.size());
+            for (std::size_t i {0}; i < robots.size(); ++i)
+            {
+                m_chosen[i] = i;
+            }
+
+            std::size_t topCount {std::min(m_settings.topCount, robots.size())};
+            const std::vector<double>& fitness {robots.getFitness()};
+            std::partial_sort(m_chosen.begin(), m_chosen.begin() + static_cast<std::ptrdiff_t>(topCount), m_chosen.end(), [&fitness](std::size_t a, std::size_t b) {
+                return fitness[a] > fitness[b] || (fitness[a] == fitness[b] && a < b);
+            });
+            m_chosen.resize(topCount);
+
+            for (std::size_t robot : m_settings.robots)
+            {
+                if (robot < robots.size() && std::find(m_chosen.begin(), m_chosen.end(), robot) == m_chosen.end())
+                    m_chosen.push_back(robot);
+            }
+        }
+    public:
+        TrajectoryRecorder(const RecordSettings& settings, TrajectoryWriter& writer)
+        : m_settings {settings}
+        , m_writer {writer}
+        {
+        }
+
+        // returns how many lives were written, robots whose first trial this run did not see
+        // (survivors loaded from a checkpoint) are left out
+        std::size_t record(int generation, const Population<Grid, GeneCount>& robots, const EvaluationSet<Grid>* fixedSet)
+        {
+            choose(robots);
+
+            std::size_t written {0};
+            for (std::size_t i : m_chosen)
+            {
+                const LifeStart& start {robots.getLifeStart(i)};
+                if (!fixedSet && !start.recorded)
+                    continue;
+
+                const BatteryLayout<Grid>& layout {fixedSet ? fixedSet->getLayout(0) : robots.getLayout(i)};
+                Coordinates spawn {fixedSet ? fixedSet->getSpawn(0) : start.spawn};
+                Rng rng {fixedSet ? fixedSet->getRng(0) : Rng {start.seed}};
+
+                Robot<Grid, GeneCount> robot {robots.getGenome(i), layout, spawn};
+                m_steps.clear();
+                while (robot.getPower() != 0)
+                {
+                    robot.updateSensor();
+                    robot.update(rng, m_steps);
+                }
+
+                TrajectoryRecord record {static_cast<std::uint32_t>(generation), static_cast<std::uint32_t>(i), layout.getSeed(), spawn.x, spawn.y,
+                                         robot.getPowerHarvested(), robot.getTurnsSurvived(), static_cast<std::uint32_t>(m_steps.size()), robots.getFitness(i)};
+                m_writer.write(record, robots.getGenome(i), m_steps);
+                ++written;
+            }
+
+            // the steps taken again here were already counted during evaluation
+            SimulationCounters replayed {};
+            takeThreadCounters(replayed);
+            return written;
+        }
+};
+
+#endif
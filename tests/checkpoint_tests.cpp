@@ -0,0 +1,137 @@
+// checks that --resume only loads checkpoints a run can carry on from
+// every check saves a small run, changes the file and opens it again the way --resume does
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+
+#include "checkpoint.h"
+#include "genome.h"
+#include "grid.h"
+#include "map.h"
+#include "population.h"
+#include "rng.h"
+
+// Function Prototypes
+bool saveTestRun(const std::string& path);
+bool readHeader(const std::string& path, CheckpointHeader& header);
+template <typename T>
+bool overwrite(const std::string& path, std::uint64_t offset, const T& value);
+bool overwriteGeneWord(const std::string& path, std::size_t robot, std::uint64_t word);
+template <typename T>
+bool overwriteRobotField(const std::string& path, std::uint64_t CheckpointHeader::* section, std::size_t robot, const T& value);
+bool check(bool passed, const std::string& name);
+bool checkRejected(const std::string& path, bool changed, const std::string& name);
+
+int main()
+{
+    const std::string path {"checkpoint_tests.bin"};
+    bool passed {true};
+
+    {
+        CheckpointFile file {};
+        passed &= check(saveTestRun(path) && file.open(path), "a saved run opens");
+    }
+
+    // a sensor state of 3 in the first gene of robot 5
+    passed &= checkRejected(path, saveTestRun(path) && overwriteGeneWord(path, 5, 0x0003), "a sensor state of 3 is rejected");
+
+    // an action code of 7 in the last gene of robot 0
+    passed &= checkRejected(path, saveTestRun(path) && overwriteGeneWord(path, 0, std::uint64_t {0x0700} << 48), "an action code above 4 is rejected");
+
+    // the highest codes that are still allowed
+    {
+        CheckpointFile file {};
+        std::uint64_t gene {0x042a};
+        passed &= check(saveTestRun(path) && overwriteGeneWord(path, 3, gene | gene << 16 | gene << 32 | gene << 48) && file.open(path), "batteries and random moves are kept");
+    }
+
+    // the run settings a resumed run takes from the header
+    passed &= checkRejected(path, saveTestRun(path) && overwrite(path, offsetof(CheckpointHeader, width), std::int32_t {0}), "a width of 0 is rejected");
+    passed &= checkRejected(path, saveTestRun(path) && overwrite(path, offsetof(CheckpointHeader, height), std::int32_t {-3}), "a negative height is rejected");
+    passed &= checkRejected(path, saveTestRun(path) && overwrite(path, offsetof(CheckpointHeader, batteryPercent), std::int32_t {100}), "a grid full of batteries is rejected");
+    passed &= checkRejected(path, saveTestRun(path) && overwrite(path, offsetof(CheckpointHeader, trials), std::uint64_t {0}), "0 trials is rejected");
+    passed &= checkRejected(path, saveTestRun(path) && overwrite(path, offsetof(CheckpointHeader, robotCount), std::uint64_t {2}), "a population of 2 is rejected");
+    passed &= checkRejected(path, saveTestRun(path) && overwrite(path, offsetof(CheckpointHeader, robotCount), std::uint64_t {10}), "a population of 10 is rejected");
+    passed &= checkRejected(path, saveTestRun(path) && overwrite(path, offsetof(CheckpointHeader, generation), std::uint64_t {1} << 40), "a generation past the int range is rejected");
+
+    // robots the simulation can't put on the grid
+    passed &= checkRejected(path, saveTestRun(path) && overwriteRobotField(path, &CheckpointHeader::coordinatesOffset, 2, Coordinates {0, 5}), "a robot on the top wall is rejected");
+    passed &= checkRejected(path, saveTestRun(path) && overwriteRobotField(path, &CheckpointHeader::coordinatesOffset, 2, Coordinates {11, 5}), "a robot below the grid is rejected");
+    passed &= checkRejected(path, saveTestRun(path) && overwriteRobotField(path, &CheckpointHeader::coordinatesOffset, 7, Coordinates {5, 11}), "a robot right of the grid is rejected");
+    passed &= checkRejected(path, saveTestRun(path) && overwriteRobotField(path, &CheckpointHeader::powerOffset, 4, std::int32_t {-1}), "negative power is rejected");
+    passed &= checkRejected(path, saveTestRun(path) && overwriteRobotField(path, &CheckpointHeader::turnsSurvivedOffset, 4, std::int32_t {-1}), "negative turns are rejected");
+
+    // the corners of the grid are still inside it
+    {
+        CheckpointFile file {};
+        passed &= check(saveTestRun(path) && overwriteRobotField(path, &CheckpointHeader::coordinatesOffset, 0, Coordinates {1, 1})
+                        && overwriteRobotField(path, &CheckpointHeader::coordinatesOffset, 1, Coordinates {10, 10}) && file.open(path), "robots in the corners are kept");
+    }
+
+    std::remove(path.c_str());
+    return passed ? 0 : 1;
+}
+
+// twelve robots on their own layouts, saved after generation 0
+bool saveTestRun(const std::string& path)
+{
+    DefaultGrid grid {};
+    Rng rng {11};
+    LayoutSource<DefaultGrid> layouts {grid, 0, rng};
+    Population<DefaultGrid, DEFAULT_GENE_COUNT> robots {12, layouts, rng};
+
+    CheckpointSettings settings {};
+    settings.seed = 11;
+    return saveCheckpoint(path, settings, 1, robots, layouts, rng);
+}
+
+bool readHeader(const std::string& path, CheckpointHeader& header)
+{
+    std::ifstream file {path, std::ios::binary};
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&header), sizeof(header)));
+}
+
+// write value over the bytes at offset
+template <typename T>
+bool overwrite(const std::string& path, std::uint64_t offset, const T& value)
+{
+    std::fstream file {path, std::ios::binary | std::ios::in | std::ios::out};
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    return static_cast<bool>(file);
+}
+
+// replace the first genome word of a saved robot
+bool overwriteGeneWord(const std::string& path, std::size_t robot, std::uint64_t word)
+{
+    CheckpointHeader header {};
+    return readHeader(path, header) && overwrite(path, header.genomesOffset + robot * header.wordsPerGenome * sizeof(std::uint64_t), word);
+}
+
+// replace one robot's entry in one of the arrays
+template <typename T>
+bool overwriteRobotField(const std::string& path, std::uint64_t CheckpointHeader::* section, std::size_t robot, const T& value)
+{
+    CheckpointHeader header {};
+    return readHeader(path, header) && overwrite(path, header.*section + robot * sizeof(T), value);
+}
+
+bool check(bool passed, const std::string& name)
+{
+    std::cout << (passed ? "passed: " : "FAILED: ") << name << '\n';
+    return passed;
+}
+
+// changed is false if the file couldn't be saved or changed
+bool checkRejected(const std::string& path, bool changed, const std::string& name)
+{
+    CheckpointFile file {};
+    bool passed {check(changed && !file.open(path), name)};
+    if (!file.getError().empty())
+        std::cout << "    " << file.getError() << '\n';
+    return passed;
+}